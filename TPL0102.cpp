@@ -8,12 +8,30 @@
                         1.2.3 - June - Two LEDs can be integrated as part of the instantiation. The library manages these as a channel selection indicator.
                                      This feature is used by the new development boards available in Tindie
                         1.2.4 - added a new overloaded setup for overriding the resistance value . General cleanup
+                        1.2.5 - The speed argument of begin() is now applied to the bus (it was hard-coded to STANDARD). Added setBusSpeed()
     License: MIT                
 
 */
 
 #include "TPL0102.h"
+#if defined(ESP32)
+#include <driver/gpio.h>
+#endif
 
+// Constants (flash)
+
+const char TPL0102::LBL_POT_A[8] PROGMEM = "POT A: ";
+const char TPL0102::LBL_POT_B[8] PROGMEM = "POT B: ";
+
+const char TPL0102::LBL_REG_IVRA[7] PROGMEM = "IVRA: ";
+const char TPL0102::LBL_REG_IVRB[7] PROGMEM = "IVRB: ";
+const char TPL0102::LBL_REG_ACR[7] PROGMEM = "ACR_: ";
+
+const char *const TPL0102::POT_LABELS[2] PROGMEM = {LBL_POT_A, LBL_POT_B};
+const char *const TPL0102::REGISTER_LABELS[3] PROGMEM = {LBL_REG_IVRA, LBL_REG_IVRB, LBL_REG_ACR};
+
+constexpr float TPL0102::nominal;
+const TPL0102::channels TPL0102::channel = TPL0102::channels();
 
 // Constructors
 
@@ -41,19 +59,10 @@ TPL0102::TPL0102(uint8_t ledA, uint8_t ledB) {
 
   _selectedChannel = 0;    // By default Pot A is selected
 
-  _pinLedA = ledA;
-  _pinLedB = ledB;
+  _boardLEDs[0] = ledA;
+  _boardLEDs[1] = ledB;
 
-  pinMode(_pinLedA, OUTPUT);
-  pinMode(_pinLedB, OUTPUT);
-
-  _boardLEDs[0] = _pinLedA;
-  _boardLEDs[1] = _pinLedB;
-
-  _prevLEDsState[0] = LOW;
-  _prevLEDsState[1] = LOW;
-
-  toggleLED(_selectedChannel);
+  // No GPIO work at static-init time: the pins are set up by the first update (begin() or setChannel())
 
 }
 
@@ -64,63 +73,83 @@ TPL0102::TPL0102(uint8_t ledA, uint8_t ledB, bool DEBUG) {
 
   _selectedChannel = 0;    // By default Pot A is selected
 
-  _pinLedA = ledA;
-  _pinLedB = ledB;
+  _boardLEDs[0] = ledA;
+  _boardLEDs[1] = ledB;
+
+  // No GPIO work at static-init time: the pins are set up by the first update (begin() or setChannel())
 
-  pinMode(_pinLedA, OUTPUT);
-  pinMode(_pinLedB, OUTPUT);
+}
 
-  _boardLEDs[0] = _pinLedA;
-  _boardLEDs[1] = _pinLedB;
+// Methods
 
-  _prevLEDsState[0] = LOW;
-  _prevLEDsState[1] = LOW;
+// Labels are printable straight from flash: Serial.print(pot.potLabel(ch))
+const __FlashStringHelper *TPL0102::potLabel(uint8_t ch) {
 
-  toggleLED(_selectedChannel);
+  return reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&POT_LABELS[ch & 0x01]));
 
 }
 
-// Methods
+// reg: 0 -> IVRA, 1 -> IVRB, 2 -> ACR
+const __FlashStringHelper *TPL0102::registerLabel(uint8_t reg) {
 
-void TPL0102::begin(uint16_t addr, uint32_t speed) {
-  
-  Wire.begin(SDA,SCL);
-  Wire.setClock(STANDARD);
+  return reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&REGISTER_LABELS[(reg < 3) ? reg : 2]));
 
-  address = addr;
-  _nominalResistance = TPL0102_NOMINAL_RESISTANCE;
-  // I need to assign the previous value!
-  readRegistersStatus();
-  
-  _tapPointer[0] = _initialState[0];
-  _tapPointer[1] = _initialState[1];
+}
 
-  if(_debug){
+void TPL0102::begin(uint16_t addr, uint32_t speed) {
 
-  Serial.println(F("Initializing TPL0102..."));
+  begin(Wire, addr, TPL0102_NOMINAL_RESISTANCE, speed, SDA, SCL);
 
-  Serial.println(F("Initial values:"));
-  
-  for(int i = 0; i < 2; i++){
-    Serial.print (POT_LABELS[i]);
-    Serial.println(_tapPointer[i]);
-    }
-  }
 }
 
 void TPL0102::begin(uint16_t addr, float nomRes, uint32_t speed) {
-  
-  Wire.begin(SDA,SCL);
-  Wire.setClock(STANDARD);
 
-  address = addr;
-  _nominalResistance = nomRes;
-  // I need to assign the previous value!
-  readRegistersStatus();
-  
-  _tapPointer[0] = _initialState[0];
-  _tapPointer[1] = _initialState[1];
+  begin(Wire, addr, nomRes, speed, SDA, SCL);
 
+}
+
+// Any TwoWire bus (e.g. Wire1 on the ESP32) with its default pins
+void TPL0102::begin(TwoWire &wirePort, uint16_t addr, uint32_t speed) {
+
+  begin(wirePort, addr, TPL0102_NOMINAL_RESISTANCE, speed, -1, -1);
+
+}
+
+// Any TwoWire bus on the given pins (only the ESP32 can remap them)
+void TPL0102::begin(TwoWire &wirePort, uint16_t addr, uint32_t speed, int sda, int scl) {
+
+  begin(wirePort, addr, TPL0102_NOMINAL_RESISTANCE, speed, sda, scl);
+
+}
+
+void TPL0102::begin(TwoWire &wirePort, uint16_t addr, float nomRes, uint32_t speed) {
+
+  begin(wirePort, addr, nomRes, speed, -1, -1);
+
+}
+
+// Pins < 0 keep the default pins of that bus
+
+void TPL0102::begin(TwoWire &wirePort, uint16_t addr, float nomRes, uint32_t speed, int sda, int scl) {
+
+  begin(*TPL0102WireTransport::forBus(&wirePort), addr, nomRes, speed, sda, scl);
+
+}
+
+// Any other backend (see TPL0102Transport.h), e.g. TPL0102IdfTransport on the ESP32
+void TPL0102::begin(TPL0102Transport &transport, uint16_t addr, uint32_t speed) {
+
+  begin(transport, addr, TPL0102_NOMINAL_RESISTANCE, speed, -1, -1);
+
+}
+
+void TPL0102::begin(TPL0102Transport &transport, uint16_t addr, float nomRes, uint32_t speed, int sda, int scl) {
+
+  setupBus(transport, addr, nomRes, speed, sda, scl);
+
+  readRegistersStatus();      // Seeds _tapPointer and the ACR shadow
+
+#if TPL0102_DEBUG
   if(_debug){
 
   Serial.println(F("Initializing TPL0102..."));
@@ -128,406 +157,1889 @@ void TPL0102::begin(uint16_t addr, float nomRes, uint32_t speed) {
   Serial.println(F("Initial values:"));
   
   for(int i = 0; i < 2; i++){
-    Serial.print (POT_LABELS[i]);
+    Serial.print (potLabel(i));
     Serial.println(_tapPointer[i]);
     }
   }
+#endif
 }
 
-float TPL0102:: wiper(uint8_t ch) {
+// Wake-up path: no bus reads. The wipers and ACR come from a snapshot() the firmware kept
+// (e.g. in RTC memory across deep sleep). With lazyVerify the first write or inc/dec checks
+// that state against the chip first, see verifyState()
+void TPL0102::beginFast(uint16_t addr, const TPL0102Snapshot &state, uint32_t speed, bool lazyVerify) {
 
-  _selectedChannel = ch;
+  beginFast(Wire, addr, TPL0102_NOMINAL_RESISTANCE, speed, state, lazyVerify);
 
-  return (_tapPointer[ch]) / TPL0102_TAP_NUMBER;
+}
+
+void TPL0102::beginFast(TwoWire &wirePort, uint16_t addr, float nomRes, uint32_t speed, const TPL0102Snapshot &state, bool lazyVerify) {
+
+  beginFast(*TPL0102WireTransport::forBus(&wirePort), addr, nomRes, speed, state, lazyVerify);
 
 }
 
-/* Switchs ON/OFF the device*/
+void TPL0102::beginFast(TPL0102Transport &transport, uint16_t addr, float nomRes, uint32_t speed, const TPL0102Snapshot &state, bool lazyVerify) {
 
-void TPL0102::switchPot(uint8_t ch, uint8_t st){
+  setupBus(transport, addr, nomRes, speed, -1, -1);
 
-  _selectedChannel = ch;
+  TPL0102_LOCK();
 
-  char ACR_VALUE = 0;
-  uint8_t SHDN_INSTR = 0;
+  _tapPointer[0] = state.tap[0];
+  _tapPointer[1] = state.tap[1];
+  _acr = state.acr & ~WIP_MASK;
+  _cacheValid = TPL0102_CACHE_A | TPL0102_CACHE_B | TPL0102_CACHE_ACR;    // Trusted
+  _lastError = 0;
+  _verifyPending = lazyVerify;
 
-  Wire.beginTransmission(address);
-  Wire.write(ACR);
-  Wire.endTransmission(false);   // --> Thanks to https://forum.arduino.cc/index.php?topic=385377.0
-  Wire.requestFrom(address, static_cast<size_t>(1), static_cast<bool>(false));
+}
 
-  while (Wire.available())   // slave may send less than requested
-  {
-    ACR_VALUE = Wire.read();    // receive a byte as character
+// One burst for both wipers plus the ACR, compared with the cache. Mismatches are fixed in the
+// cache and reported as TPL0102_VERIFY_MISMATCH. Returns the I2C result otherwise
+uint8_t TPL0102::verifyState() {
 
-  }
+  TPL0102_LOCK();
 
-  Wire.endTransmission();
+  uint8_t state[3];
+  uint8_t res = 0;
 
-  switch (st) {
+  _verifyPending = false;
 
-    case HIGH:    // Pot is active
+  if ((readRegisters(WRA, state, 2) != 2) || (readRegisters(ACR, &state[2], 1) != 1)) {
+    _cacheValid = 0;      // Unknown: nothing gets suppressed until it is written again
+    return _lastError;
+  }
 
-      SHDN_INSTR = ACR_VALUE | SHUTDOWN_MASK;
+  state[2] &= ~WIP_MASK;
 
-      break;
+  if ((state[0] != _tapPointer[0]) || (state[1] != _tapPointer[1]) || (state[2] != _acr)) {
 
-    case LOW:   // Pot is inactive
+    res = TPL0102_VERIFY_MISMATCH;
 
-      SHDN_INSTR = ACR_VALUE ^ SHUTDOWN_MASK;
+#if TPL0102_STATS
+    _stats.verifyMismatches++;
+#endif
+  }
 
-      break;
+  _tapPointer[0] = state[0];
+  _tapPointer[1] = state[1];
+  _acr = state[2];
+  _cacheValid = TPL0102_CACHE_A | TPL0102_CACHE_B | TPL0102_CACHE_ACR;
+  _lastError = res;
 
-      default:
+  return res;
+
+}
 
-      SHDN_INSTR =  ACR_VALUE  | 0x00; // Same state
+// Everything begin() and beginFast() share: the bus, the address and the scales
+void TPL0102::setupBus(TPL0102Transport &transport, uint16_t addr, float nomRes, uint32_t speed, int sda, int scl) {
 
-      break;
+  _transport = &transport;
+  _sdaPin = sda;
+  _sclPin = scl;
+
+#if !defined(ESP32)
+  if ((_sdaPin < 0) && (_transport->busKey() == &Wire)) {    // Fixed pins on the other cores: known for Wire
+    _sdaPin = SDA;
+    _sclPin = SCL;
   }
+#endif
+
+#if TPL0102_STATS
+  resetStats();
+#endif
 
-  Wire.beginTransmission(address);
-  Wire.write(ACR);
-  Wire.write(SHDN_INSTR);          // sends potentiometer value byte
-  Wire.endTransmission(true);     // stop transmitting
+  I2CSpeed = speed;
+#if TPL0102_LOCKING
+  TPL0102BusLock::forBus(_transport->busKey());    // Created here, before other tasks can race for it
+#endif
+  initBus();
+
+  address = addr;
+  setScales(nomRes);
+  _verifyPending = false;
+
+  updateLEDs();     // Lights the selected channel (pot A unless setChannel() said otherwise)
 
 }
 
-void TPL0102::inc(uint8_t ch) {    // return wiper count!
+void TPL0102::initBus() {
 
-  _selectedChannel = ch;
+  _transport->begin(I2CSpeed, _sdaPin, _sclPin);
 
-  if ((_tapPointer[ch] < TPL0102_TAP_NUMBER)) {
+}
 
+// Number of extra attempts after a failed transaction (0: fail straight away)
+void TPL0102::setRetries(uint8_t retries) {
 
-    unsigned long _startIncTime = micros();
+  _retries = retries;
+
+}
 
-    _tapPointer[ch]++;
+// Result of the last transaction once its retries were used: 0 OK, 2 address NACK, 3 data NACK, 4 other, 5 timeout
+uint8_t TPL0102::lastError() {
 
-    if (_tapPointer[ch] >= TPL0102_TAP_NUMBER)
-      _tapPointer[ch] = TPL0102_TAP_NUMBER;
+  return _lastError;
 
-    dataWrite(ch, _tapPointer[ch]);
+}
 
-    if(_debug){
+// Release a slave holding SDA low: up to 9 clocks on SCL followed by a STOP, then restart the bus.
+// Returns true when SDA is free again. Needs the pins (see begin())
+bool TPL0102::recoverBus() {
 
-      Serial.print(F("Current step "));
-      Serial.print (POT_LABELS[ch]);
-      Serial.println(_tapPointer[ch]);
+  TPL0102_LOCK();
 
-    }
+  if ((_sdaPin < 0) || (_sclPin < 0))
+    return false;
 
-  
-    _incDelay = micros() - _startIncTime;
+  _transport->end();     // Hand the pins back to the GPIO
 
+  pinMode(_sdaPin, INPUT_PULLUP);
+  pinMode(_sclPin, INPUT_PULLUP);
+
+  for (uint8_t i = 0; (i < 9) && (digitalRead(_sdaPin) == LOW); i++) {
+
+    digitalWrite(_sclPin, LOW);
+    pinMode(_sclPin, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(_sclPin, INPUT_PULLUP);
+    delayMicroseconds(5);
   }
-}
 
+  // STOP: SDA rises while SCL is high
+  digitalWrite(_sdaPin, LOW);
+  pinMode(_sdaPin, OUTPUT);
+  delayMicroseconds(5);
+  pinMode(_sdaPin, INPUT_PULLUP);
+  delayMicroseconds(5);
 
-void TPL0102::dec(uint8_t ch) {
+  bool released = (digitalRead(_sdaPin) == HIGH);
 
-  _selectedChannel = ch;
+  initBus();
 
-  if ((_tapPointer[ch] > 0)) {
+  return released;
 
-    unsigned long _startDecTime = micros();
+}
 
-    _tapPointer[ch]--;
+// Change the I2C clock at runtime without going through begin() again
+void TPL0102::setBusSpeed(uint32_t speed) {
 
-     if (_tapPointer[ch] <= 0)
-      _tapPointer[ch] = 0;
+  I2CSpeed = speed;
+  _transport->setClock(I2CSpeed);
 
-    dataWrite(ch, _tapPointer[ch]);
+}
 
-    if(_debug){
+float TPL0102:: wiper(uint8_t ch) {
 
-      Serial.print(F("Current step "));  
-      Serial.print(POT_LABELS[ch]);
-      Serial.println(_tapPointer[ch]);
-    }
+  TPL0102_READER_SELECT(ch);
 
-    _decDelay = micros() - _startDecTime;
+  return cachedTap(ch) * (1.0 / TPL0102_TAP_NUMBER);
 
-  }
 }
 
-// Writing data to the user registers
-void TPL0102::dataWrite(uint8_t ch, uint8_t val){
+/* Switchs ON/OFF the device*/
+// Works on the ACR shadow: a single write, no read-modify-write over the bus
 
-  _selectedChannel = ch;
+uint8_t TPL0102::switchPot(uint8_t ch, uint8_t st){
 
-  uint8_t wiperPointer = WRA;
+  TPL0102_LOCK();     // Read-modify-write of the ACR shadow
 
-  switch(ch){
+  TPL0102_STATS_START(_startSwitchTime);
 
-    case 0:
-      wiperPointer = WRA;
-    break;
+  _selectedChannel = ch;
 
-    case 1:
-      wiperPointer = WRB;
-    break;
-  }
+  uint8_t SHDN_INSTR = _acr;
 
-    Wire.beginTransmission(address);
-    Wire.write(wiperPointer);
-    Wire.write(val);    // sends potentiometer value byte
-    int res = Wire.endTransmission(true);     // stop transmitting
-    if (_debug)
-    Serial.printf("result of I2C transmission potentionneter is %d, I2C Address: %u\n", res,address);
+  switch (st) {
 
-}
+    case HIGH:    // Pot is active
 
-// Returns how long it took to increase the value
-unsigned long TPL0102::incMicros() {
+      SHDN_INSTR = _acr | SHUTDOWN_MASK;
 
-  return _incDelay;
+      break;
 
-}
+    case LOW:   // Pot is inactive
 
-// Returns how long it took to decrease the value
-unsigned long TPL0102::decMicros() {
+      SHDN_INSTR = _acr & ~SHUTDOWN_MASK;
 
-  return _decDelay;
+      break;
 
-}
+      default:
 
-// Returns how long it took to set the value
-unsigned long TPL0102::setMicros() {
+      SHDN_INSTR =  _acr  | 0x00; // Same state
 
-  return _setDelay;
+      break;
+  }
 
-}
+  uint8_t res = writeACR(SHDN_INSTR);
 
-// Keeps a record of the current tap being addressed
-uint8_t TPL0102::taps(uint8_t ch) {
+  TPL0102_STATS_STOP(TPL0102_OP_SWITCH, _startSwitchTime);
 
-  _selectedChannel = ch;
+  return res;
 
-  return _tapPointer[ch];   // value within [1-64] that points to the taps between resistors [0,63]
 }
 
-// Set a desired resistance --> EXTREMELY APPROXIMATE AND THEORETICAL. USE WITH CARE!
-uint8_t TPL0102::setValue(uint8_t ch, float desiredR) {
+// Select which registers the wiper addresses hit: volatile WR (true) or non-volatile IVR (false)
+uint8_t TPL0102::setVolatileAccess(bool volatileRegs){
 
-  float distance;
-  int tapTarget;
+  if (volatileRegs)
+    return writeACR(_acr | VOL_MASK);
+  else
+    return writeACR(_acr & ~VOL_MASK);
 
-  unsigned long _startSetTime = micros();
+}
 
-  tapTarget = round((desiredR * TPL0102_TAP_NUMBER) / _nominalResistance);
-  distance = abs(_tapPointer[ch] - tapTarget);
+// Leave shutdown and set both wipers in one bus session: the ACR (0x10) and the wipers (0x00-0x01)
+// are not consecutive, so the ACR write ends with a repeated START and the wiper write with the STOP.
+// Only the registers that change are sent. Transports that cannot chain (TPL0102_CHAIN_NONE) get
+// two separate writes: the shadow only moves once the chip has acked. Returns the I2C result
+uint8_t TPL0102::wakeWithTaps(uint8_t tapA, uint8_t tapB){
 
-  if (_debug){
+  TPL0102_LOCK();
 
-  Serial.print(F("Distance to target: "));
-  Serial.println(distance);
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;
 
-  Serial.print(F("Target tap: "));
-  Serial.println(tapTarget);
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
 
-  Serial.print(F("desiredR: "));
-  Serial.println(desiredR);
+  uint8_t acrValue = (_acr | SHUTDOWN_MASK) & ~WIP_MASK;
 
-  Serial.print(F("ch: "));
-  Serial.println(ch);
+  bool wipersCached = ((_cacheValid & (TPL0102_CACHE_A | TPL0102_CACHE_B)) == (TPL0102_CACHE_A | TPL0102_CACHE_B))
+                      && (tapA == _tapPointer[0]) && (tapB == _tapPointer[1]);
 
-  Serial.print(F("_tapPointer[ch]: "));
-  Serial.println(_tapPointer[ch]);
+  if (wipersCached || ((_cacheValid & TPL0102_CACHE_ACR) && (acrValue == _acr))
+      || (_transport->chaining() != TPL0102_CHAIN_SENT)) {
 
-  Serial.println();
+    uint8_t res = writeACR(acrValue);     // One of the two is a no-op, or no session to share
 
+    return (res == 0) ? dataWriteBoth(tapA, tapB) : res;
   }
 
-   if (tapTarget != _tapPointer[ch]) {
+  uint8_t res = _transport->write(address, ACR, &acrValue, 1, false);     // repeated START into the wiper write, result known now
+  TPL0102_STATS_RESULT(res);
 
-    dataWrite(ch, tapTarget);
-    _tapPointer[ch] = tapTarget;
+  TPL0102_TRACE(TPL0102_TRACE_ACR, 0, acrValue, res);
 
-  } else {
-    // Leave everything where it is
+  if (res != 0) {
+
+    _cacheValid &= ~TPL0102_CACHE_ACR;
+    res = writeACR(acrValue);           // Separate transactions, with the usual retries
+
+    return (res == 0) ? dataWriteBoth(tapA, tapB) : res;
   }
 
-  _setDelay = micros() - _startSetTime;
+  _acr = acrValue;
+  _cacheValid |= TPL0102_CACHE_ACR;
 
-  return tapTarget;
+  return dataWriteBoth(tapA, tapB);     // At least one wiper changes: this write sends the STOP
 
 }
 
-uint8_t TPL0102::setTap(uint8_t ch, uint8_t desiredTap) {
-
-  float distance;
-  int tapTarget;
+// Store the current wiper of one channel in its IVR (loaded again at power-up).
+// Blocks only until the chip clears WIP, or TPL0102_NV_TIMEOUT_MS at most
+uint8_t TPL0102::saveToNonVolatile(uint8_t ch){
 
-  unsigned long _startSetTime = micros();
+  uint8_t res = saveToNonVolatileAsync(ch);
 
-  tapTarget = desiredTap;
-  distance = abs(_tapPointer[ch] - tapTarget);
+  return (res == 0) ? waitNonVolatile() : res;
 
-  if (_debug){
+}
 
-  Serial.print(F("Distance to target: "));
-  Serial.println(distance);
+// Both IVRs with a single dual-register write: one EEPROM cycle to wait for
+uint8_t TPL0102::saveBoth(){
 
-  Serial.print(F("Target tap: "));
-  Serial.println(tapTarget);
-  Serial.println();
+  uint8_t res = saveBothAsync();
 
+  return (res == 0) ? waitNonVolatile() : res;
 
-  }
+}
 
-   if (tapTarget != _tapPointer[ch]) {
+// Start the save and return straight away. Poll nonVolatileBusy() until it returns false
+uint8_t TPL0102::saveToNonVolatileAsync(uint8_t ch){
 
-    dataWrite(ch, tapTarget);
-    _tapPointer[ch] = tapTarget;
+  return startNonVolatile((ch == CHB) ? IVRB : IVRA, &_tapPointer[ch], 1);
 
-  } else {
-    // Leave everything where it is
-  }
+}
 
-  _setDelay = micros() - _startSetTime;
+uint8_t TPL0102::saveBothAsync(){
 
-  return tapTarget;
+  return startNonVolatile(IVRA, _tapPointer, 2);
 
 }
 
-// Select a specific channel and return the value that was selected.
-// Dumb-ish but useful(ish)
+// True while the EEPROM write runs, or while WIP cannot be read. Once WIP clears, the previous ACR
+// access mode is restored. The writers call it too: after a TPL0102_NV_TIMEOUT the next write checks
+// WIP again and goes through as soon as the save is over
+bool TPL0102::nonVolatileBusy(){
 
-uint8_t TPL0102::setChannel(uint8_t ch){
+  TPL0102_LOCK();
 
-  _selectedChannel = ch;
+  if (_nvRestoreACR == TPL0102_NV_IDLE)
+    return false;
 
-   if(_ledsDefined){
-      toggleLED(_selectedChannel);
-    }
+  uint8_t acrValue;
 
-  return _selectedChannel;
+  if (readRegisters(ACR, &acrValue, 1) != 1)
+    return true;      // Not confirmed: still busy, the error is in lastError() (waitNonVolatile() times out)
 
-}
+  if (acrValue & WIP_MASK)
+    return true;
 
-// Turn the pot all the way down
-void TPL0102::zeroWiper(uint8_t ch) {
+  // WR / ACR are writable again (WIP = 0). Only the access mode (VOL) goes back:
+  // the rest of the ACR keeps whatever the shadow holds now
+  uint8_t restoreACR = (_acr & ~VOL_MASK) | (_nvRestoreACR & VOL_MASK);
 
-  _selectedChannel = ch;
+  _nvRestoreACR = TPL0102_NV_IDLE;
+  writeACR(restoreACR);
 
-  _tapPointer[ch] = 0;
-  dataWrite(ch, _tapPointer[ch]);
+  return false;
 
 }
 
-// Turn the pot all the way up
-void TPL0102::maxWiper(uint8_t ch) {
+uint8_t TPL0102::startNonVolatile(uint8_t reg, const uint8_t *vals, uint8_t len){
 
-  _selectedChannel = ch;
+  TPL0102_LOCK();
 
-    _tapPointer[ch] = TPL0102_TAP_NUMBER;
-  dataWrite(ch, _tapPointer[ch]);
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;     // Previous save still running
 
-}
+  uint8_t previousACR = _acr;
 
-// Get the theoretical current resistance value
-float TPL0102::readValue(uint8_t ch) {
+  uint8_t res = writeACR(_acr & ~VOL_MASK);     // Non-volatile registers accessible
 
-  _selectedChannel = ch;
+  if (res == 0)
+    res = writeRegisters(reg, vals, len);       // IVR (and WR) get the value
+
+  if (res == 0)
+    _nvRestoreACR = previousACR;
+  else
+    writeACR(previousACR);
 
-  return (_tapPointer[ch] / TPL0102_TAP_NUMBER) * (_nominalResistance);
+  return res;
 
 }
 
-// Check the values from the system registers
-void TPL0102::readRegistersStatus() {
+uint8_t TPL0102::waitNonVolatile(){
 
-  for (int pos = 0; pos < 3; pos++) {
+  unsigned long start = millis();
 
-    Wire.beginTransmission(address);
-    Wire.write(_regs[pos]);
-    Wire.endTransmission(false);   // --> Thanks to https://forum.arduino.cc/index.php?topic=385377.0
-    Wire.requestFrom(address, static_cast<size_t>(1), static_cast<bool>(false));
+  while (nonVolatileBusy()) {
 
-    while (Wire.available())   // slave may send less than requested
-    {
-      char I2CResponse = (char)Wire.read();    // receive a byte as character
+    if (millis() - start > TPL0102_NV_TIMEOUT_MS)
+      return TPL0102_NV_TIMEOUT;
 
-      _initialState[pos] = (uint8_t)I2CResponse;
+    yield();
+  }
+
+  return _lastError;
 
-      if (_debug) {
+}
 
-        Serial.println(F(" ******************** "));
-        
-        Serial.print(REGISTER_LABELS[pos]);
-        Serial.print(I2CResponse, HEX);
-        Serial.print(F(" (HEX)"));
+// Read ACR back from the chip and reload the shadow. Returns the value read
+uint8_t TPL0102::resyncACR(){
 
-        Serial.print(I2CResponse, DEC);
-        Serial.print(F(" (DEC)"));
-        Serial.println(F(" "));
-        Serial.println(F(" ******************** "));
-      }
-    }
+  TPL0102_LOCK();
 
-    Wire.endTransmission();
+  uint8_t acrValue;
 
+  if (readRegisters(ACR, &acrValue, 1) == 1) {
+    _acr = acrValue & ~WIP_MASK;     // WIP is read-only status, not state
+    _cacheValid |= TPL0102_CACHE_ACR;
   }
 
+  return _acr;
+
 }
 
-// Check the values from the user registers
-void TPL0102::readDummyRegStatus() {
+// Last ACR value written to (or read from) the chip
+uint8_t TPL0102::acr(){
+
+#if TPL0102_LOCKING
+  return snapshot().acr;
+#else
+  return _acr;
+#endif
 
-  for (int dummyPos = GENERAL_PURPOSE_START; dummyPos <= GENERAL_PURPOSE_END; dummyPos++) {
+}
 
-    Wire.beginTransmission(address);
-    Wire.write(dummyPos);
-    Wire.endTransmission(false);   // --> Thanks to https://forum.arduino.cc/index.php?topic=385377.0
-    Wire.requestFrom(address, static_cast<size_t>(1), static_cast<bool>(false));
+uint8_t TPL0102::writeACR(uint8_t val){
 
-    while (Wire.available())   // slave may send less than requested
-    {
+  TPL0102_LOCK();
 
-      char I2CResponse = (char)Wire.read();    // receive a byte as character
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;     // The chip ignores WR / ACR writes until the save is done
 
-      if (_debug == true) {
-        Serial.print(F("Dummy ["));
-        Serial.print(dummyPos, HEX);
-        Serial.print(F("]: "));
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
 
-        Serial.print(I2CResponse, HEX);
-        Serial.print(F(" (HEX)"));
+  val &= ~WIP_MASK;
 
-        Serial.print(I2CResponse, DEC);
-        Serial.print(F(" (DEC)"));
-        Serial.println(F(" "));
-      }
-    }
+  if (redundant(TPL0102_CACHE_ACR, _acr, val))
+    return 0;
+
+  uint8_t res = writeRegisters(ACR, &val, 1);
+
+  TPL0102_TRACE(TPL0102_TRACE_ACR, 0, val, res);
 
-    Wire.endTransmission();
+  if (res == 0) {
+    _acr = val;
+    _cacheValid |= TPL0102_CACHE_ACR;
+  } else {
+    _cacheValid &= ~TPL0102_CACHE_ACR;    // The chip may or may not have it
   }
+
+  return res;
+
 }
 
-// Switch ON/OFF the LEDs attached to the board or
-// close to the pots being used. 
-void TPL0102::toggleLED(uint8_t ch){
+// Every mutator ends up here: true (and nothing sent) when the chip already holds val
+bool TPL0102::redundant(uint8_t mask, uint8_t cached, uint8_t val){
 
-  switch(ch){
+  if (!(_cacheValid & mask) || (cached != val))
+    return false;
+
+  _lastError = 0;
+
+#if TPL0102_STATS
+  _stats.suppressedWrites++;
+#endif
+
+  return true;
+
+}
+
+uint8_t TPL0102::inc(uint8_t ch) {    // returns the I2C result
+
+  TPL0102_LOCK();
+
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
+
+  uint8_t res = 0;
+
+  _selectedChannel = ch;
+
+  if ((_tapPointer[ch] < TPL0102_TAP_NUMBER)) {
 
-    case 0:
 
-            digitalWrite(_boardLEDs[0], HIGH);
-            digitalWrite(_boardLEDs[1], LOW);
+    unsigned long _startIncTime = micros();
+
+    res = dataWrite(ch, _tapPointer[ch] + 1);    // The cache moves only once the chip has it
 
-            _prevLEDsState[0] = HIGH;
-            _prevLEDsState[1] = LOW;
+#if TPL0102_DEBUG
+    if(_debug){
 
-  break;
+      Serial.print(F("Current step "));
+      Serial.print (potLabel(ch));
+      Serial.println(_tapPointer[ch]);
 
-  case 1:
+    }
+#endif
 
-            digitalWrite(_boardLEDs[1], HIGH);
-            digitalWrite(_boardLEDs[0], LOW);
+  
+    _incDelay = micros() - _startIncTime;
+    TPL0102_STATS_LATENCY(TPL0102_OP_INC, _incDelay);
 
-            _prevLEDsState[1] = HIGH;
-            _prevLEDsState[0] = LOW;
+  }
 
-  break;
+  return res;
 }
+
+
+uint8_t TPL0102::dec(uint8_t ch) {
+
+  TPL0102_LOCK();
+
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
+
+  uint8_t res = 0;
+
+  _selectedChannel = ch;
+
+  if ((_tapPointer[ch] > 0)) {
+
+    unsigned long _startDecTime = micros();
+
+    res = dataWrite(ch, _tapPointer[ch] - 1);    // The cache moves only once the chip has it
+
+#if TPL0102_DEBUG
+    if(_debug){
+
+      Serial.print(F("Current step "));  
+      Serial.print(potLabel(ch));
+      Serial.println(_tapPointer[ch]);
+    }
+#endif
+
+    _decDelay = micros() - _startDecTime;
+    TPL0102_STATS_LATENCY(TPL0102_OP_DEC, _decDelay);
+
+  }
+
+  return res;
+}
+
+// Writing data to the user registers
+uint8_t TPL0102::dataWrite(uint8_t ch, uint8_t val){
+
+  TPL0102_LOCK();
+
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;     // Save still running: WIP is checked again on every write
+
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
+
+  TPL0102_STATS_START(_startWriteTime);
+
+  _selectedChannel = ch;
+
+  _pendingMask &= ~(TPL0102_SLEW_A << (ch & 0x01));    // A direct write interrupts a slew
+
+  uint8_t wiperPointer = WRA;
+  uint8_t cacheBit = TPL0102_CACHE_A;
+
+  switch(ch){
+
+    case 0:
+      wiperPointer = WRA;
+      cacheBit = TPL0102_CACHE_A;
+    break;
+
+    case 1:
+      wiperPointer = WRB;
+      cacheBit = TPL0102_CACHE_B;
+    break;
+  }
+
+    if (redundant(cacheBit, _tapPointer[ch], val))
+      return 0;
+
+    uint8_t res = writeRegisters(wiperPointer, &val, 1);
+
+    if (res == 0) {
+
+      _tapPointer[ch] = val;
+      _cacheValid |= cacheBit;
+
+      if (verifyDue())
+        res = verifyWipers(ch, 1, &val);
+
+    } else {
+      _cacheValid &= ~cacheBit;
+    }
+
+    TPL0102_TRACE(TPL0102_TRACE_WRITE, ch, val, res);
+    TPL0102_STATS_STOP(TPL0102_OP_WRITE, _startWriteTime);
+
+#if TPL0102_DEBUG
+    if (_debug){
+      Serial.print(F("I2C result: "));
+      Serial.print(res);
+      Serial.print(F(", I2C Address: "));
+      Serial.println(address);
+    }
+#endif
+
+    return res;
+
+}
+
+// Writing both wipers in a single transaction. The register pointer auto-increments
+// after every data byte, so WRB is written right after WRA without a new START/address
+uint8_t TPL0102::dataWriteBoth(uint8_t valA, uint8_t valB){
+
+    TPL0102_LOCK();
+
+    if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+      return TPL0102_NV_BUSY;     // Save still running: WIP is checked again on every write
+
+    if (_verifyPending)
+      verifyState();     // First use after beginFast()
+
+    _pendingMask &= ~(TPL0102_SLEW_A | TPL0102_SLEW_B);
+
+    bool sameA = (_cacheValid & TPL0102_CACHE_A) && (_tapPointer[0] == valA);
+    bool sameB = (_cacheValid & TPL0102_CACHE_B) && (_tapPointer[1] == valB);
+
+    if (sameA && sameB) {
+      redundant(TPL0102_CACHE_A, _tapPointer[0], valA);    // One call suppressed: counted once
+      return 0;
+    }
+
+    // Only one of them changes: a single-register write is a byte shorter
+    if (sameA && redundant(TPL0102_CACHE_A, _tapPointer[0], valA))
+      return dataWrite(CHB, valB);
+
+    if (sameB && redundant(TPL0102_CACHE_B, _tapPointer[1], valB))
+      return dataWrite(CHA, valA);
+
+    TPL0102_STATS_START(_startWriteTime);
+
+    uint8_t vals[2] = {valA, valB};     // WRA, WRB (auto-increment)
+
+    uint8_t res = writeRegisters(WRA, vals, 2);
+
+    if (res == 0) {
+
+      _tapPointer[0] = valA;
+      _tapPointer[1] = valB;
+      _cacheValid |= TPL0102_CACHE_A | TPL0102_CACHE_B;
+
+      if (verifyDue())
+        res = verifyWipers(CHA, 2, vals);
+
+    } else {
+      _cacheValid &= ~(TPL0102_CACHE_A | TPL0102_CACHE_B);
+    }
+
+    TPL0102_TRACE(TPL0102_TRACE_WRITE_BOTH, valA, valB, res);
+    TPL0102_STATS_STOP(TPL0102_OP_WRITE, _startWriteTime);
+
+#if TPL0102_DEBUG
+    if (_debug){
+      Serial.print(F("I2C result: "));
+      Serial.print(res);
+      Serial.print(F(", I2C Address: "));
+      Serial.println(address);
+    }
+#endif
+
+    return res;
+
+}
+
+// Queue a wiper update without touching the bus. Returns false when the queue is full.
+// The write itself is synchronous: poll() (or the ESP32 task) sends it and waits for it,
+// on every transport (TPL0102Transport::writeAsync() is not used here). Single producer, single
+// consumer ring: the one call that is safe from loop() while startAsyncTask() runs
+bool TPL0102::setTapAsync(uint8_t ch, uint8_t val) {
+
+  uint8_t next = (_asyncHead + 1) % TPL0102_ASYNC_QUEUE_SIZE;
+
+  if (next == _asyncTail)
+    return false;
+
+  _asyncQueue[_asyncHead].ch = ch;
+  _asyncQueue[_asyncHead].val = val;
+  _asyncHead = next;
+
+  return true;
+
+}
+
+// Move at most one queued write onto the bus. Call it from loop() (or let the ESP32 task do it).
+// Returns the number of writes still waiting
+uint8_t TPL0102::poll() {
+
+  TPL0102_LOCK();     // The whole pass: pending masks, timebases and the cache move together
+
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return asyncPending();      // Queued writes and slews stay put until the save is done
+
+  if (_pendingMask & (TPL0102_SLEW_A | TPL0102_SLEW_B))
+    slew();
+
+  if (_coalescing && (_pendingMask & 0x03) && _flushInterval) {
+
+    unsigned long elapsed = micros() - _lastFlush;
+
+    if (elapsed >= _flushInterval) {
+
+      _lastFlush += (elapsed / _flushInterval) * _flushInterval;     // Fixed grid, a late poll() does not drift it
+      flush();
+    }
+  }
+
+  if (_asyncHead == _asyncTail)
+    return 0;
+
+  uint8_t ch = _asyncQueue[_asyncTail].ch;
+  uint8_t val = _asyncQueue[_asyncTail].val;
+
+  uint8_t res = dataWrite(ch, val);
+
+  _asyncTail = (_asyncTail + 1) % TPL0102_ASYNC_QUEUE_SIZE;
+
+  if (_asyncCallback)
+    _asyncCallback(ch, val, res);
+
+  return asyncPending();
+
+}
+
+// Number of queued writes not sent yet. Zero means every async write has completed
+uint8_t TPL0102::asyncPending() {
+
+  return (_asyncHead + TPL0102_ASYNC_QUEUE_SIZE - _asyncTail) % TPL0102_ASYNC_QUEUE_SIZE;
+
+}
+
+// Called after every async write with the channel, the value and the I2C result (0: OK)
+void TPL0102::onAsyncComplete(AsyncCallback cb) {
+
+  _asyncCallback = cb;
+
+}
+
+// Coalescing mode: setTap()/setValue() only record the latest value per channel.
+// Pending values are sent by flush(), or by poll() every flushInterval microseconds (0: flush() only)
+void TPL0102::setCoalescing(bool enable, unsigned long flushInterval) {
+
+  TPL0102_LOCK();
+
+  if (!enable && (_pendingMask & 0x03))
+    flush();
+
+  _coalescing = enable;
+  _flushInterval = flushInterval;
+  _lastFlush = micros();
+
+}
+
+// Send the pending values: both channels share one transaction when both changed
+uint8_t TPL0102::flush() {
+
+  TPL0102_LOCK();
+
+  uint8_t res = 0;
+  uint8_t coalesced = _pendingMask & 0x03;    // Slewing channels are left to slew()
+
+  if (coalesced == 0x03) {
+
+    res = dataWriteBoth(_pendingTap[0], _pendingTap[1]);
+
+  } else if (coalesced) {
+
+    uint8_t ch = (coalesced & 0x01) ? CHA : CHB;
+
+    res = dataWrite(ch, _pendingTap[ch]);
+  }
+
+  if (res == 0)
+    _pendingMask &= ~0x03;     // Keep them pending otherwise, the next flush retries
+
+  return res;
+
+}
+
+void TPL0102::coalesce(uint8_t ch, uint8_t val) {
+
+  TPL0102_LOCK();
+
+  ch &= 0x01;
+
+  _pendingMask &= ~(TPL0102_SLEW_A << ch);     // The latest value wins over a slew in progress
+  _pendingTap[ch] = val;
+
+  if (redundant(TPL0102_CACHE_A << ch, _tapPointer[ch], val))
+    _pendingMask &= ~(1 << ch);   // Back to what the chip already holds: nothing to send
+  else
+    _pendingMask |= (1 << ch);    // Also when the cached tap is unknown (failed write)
+
+}
+
+// Move a wiper towards target by at most maxStep taps every intervalUs, in the background: poll()
+// (or the ESP32 task) does the steps. Calling it again mid-slew only retargets it, the wiper keeps
+// going from where it is. Step and interval are shared by both channels (the last call sets them),
+// the coalescing flush keeps its own. Any direct write to the channel, or stopSlew(), interrupts it.
+// Returns 0 once the slew is set up, TPL0102_NV_BUSY (nothing changes) while a save is pending
+uint8_t TPL0102::setTapSlewed(uint8_t ch, uint8_t target, uint8_t maxStep, unsigned long intervalUs) {
+
+  TPL0102_LOCK();
+
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;
+
+  ch &= 0x01;
+
+  uint8_t slewBit = TPL0102_SLEW_A << ch;
+
+  _pendingTap[ch] = target;
+  _pendingMask &= ~(1 << ch);     // Supersedes a coalesced value of the same channel
+  _slewStep = maxStep ? maxStep : 1;
+  _slewInterval = intervalUs;
+
+  if (!(_pendingMask & (TPL0102_SLEW_A | TPL0102_SLEW_B)))
+    _lastSlew = micros() - intervalUs;     // First step on the next poll()
+
+  _pendingMask |= slewBit;
+
+  return 0;
+
+}
+
+bool TPL0102::slewing(uint8_t ch) {
+
+  return _pendingMask & (TPL0102_SLEW_A << (ch & 0x01));
+
+}
+
+// Freeze the wiper where the slew left it
+void TPL0102::stopSlew(uint8_t ch) {
+
+  TPL0102_LOCK();
+
+  _pendingMask &= ~(TPL0102_SLEW_A << (ch & 0x01));
+
+}
+
+// Closed form: every interval elapsed since the last update is worth maxStep taps, so a late poll()
+// catches up without drifting. The steps that are due go out as one streamed ramp (repeated START
+// between them where the transport chains): each jump stays within maxStep
+uint8_t TPL0102::slew() {
+
+  TPL0102_LOCK();
+
+  unsigned long due = 1;      // intervalUs 0: one step per poll()
+  uint8_t res = 0;
+
+  if (_slewInterval) {
+
+    unsigned long elapsed = micros() - _lastSlew;
+
+    if (elapsed < _slewInterval)
+      return 0;
+
+    due = elapsed / _slewInterval;
+    _lastSlew += due * _slewInterval;
+  }
+
+  if (due > TPL0102_TAP_NUMBER)
+    due = TPL0102_TAP_NUMBER;     // Enough to cross the whole range
+
+  if (_verifyPending)
+    verifyState();     // First use after beginFast()
+
+  for (uint8_t ch = 0; ch < 2; ch++) {
+
+    uint8_t slewBit = TPL0102_SLEW_A << ch;
+
+    if (!(_pendingMask & slewBit))
+      continue;
+
+    uint8_t from = _tapPointer[ch];
+    uint8_t to = _pendingTap[ch];
+    unsigned long distance = (to > from) ? (to - from) : (from - to);
+    unsigned long move = due * _slewStep;
+
+    if (move > distance)
+      move = distance;
+
+    if (move) {
+
+      int dir = (to > from) ? 1 : -1;
+      uint8_t first = from + dir * (int)((move < _slewStep) ? move : _slewStep);
+      uint8_t last = from + dir * (int)move;
+
+      uint8_t chRes = streamRamp(ch, first, last, _slewStep, 0, true, _tapPointer[ch]);
+
+      if ((chRes != 0) && (res == 0))
+        res = chRes;      // Stays slewing: the next poll() retries from the last acked tap
+    }
+
+    if (_tapPointer[ch] == _pendingTap[ch])
+      _pendingMask &= ~slewBit;
+  }
+
+  return res;
+
+}
+
+#if TPL0102_LOCKING
+// Drain the async queue from a dedicated FreeRTOS task so loop() never waits on the bus.
+// Only built with TPL0102_THREAD_SAFE: poll() there runs flush(), slew() and dataWrite() under the
+// bus mutex. While the task runs, only setTapAsync() (and the lock-free readers) should be called
+// from loop(): it is the one call designed to be shared with the task, anything else contends for
+// the mutex with it
+bool TPL0102::startAsyncTask(uint8_t core, uint8_t priority) {
+
+  if (_asyncTask != NULL)
+    return true;
+
+  return xTaskCreatePinnedToCore(asyncTaskLoop, "TPL0102", 2048, this, priority, &_asyncTask, core) == pdPASS;
+
+}
+
+void TPL0102::asyncTaskLoop(void *arg) {
+
+  TPL0102 *pot = static_cast<TPL0102 *>(arg);
+
+  while (true) {
+
+    // Nothing queued, nothing slewing or coalesced: sleep without touching the mutex
+    if ((pot->asyncPending() == 0) && (pot->_pendingMask == 0)) {
+      vTaskDelay(1);
+      continue;
+    }
+
+    if (pot->poll() == 0)
+      vTaskDelay(1);    // Queue empty: slews and flushes still get a turn every tick
+  }
+}
+#endif
+
+// Move the wiper from one tap to another in a single bus session. The register pointer
+// auto-increments after each data byte, so every step re-addresses the wiper through a
+// repeated START: the bus is never released until the last step (STOP). On transports without
+// repeated START (arduino-esp32 Wire) every step is a transaction of its own, a deferred chain
+// (TPL0102IdfTransport) goes out in jobs of TPL0102_CHAIN_MAX_STEPS steps, see streamRamp()
+uint8_t TPL0102::ramp(uint8_t ch, uint8_t from, uint8_t to, uint8_t step, unsigned int stepDelay) {
+
+  TPL0102_LOCK();
+
+  _selectedChannel = ch;
+
+  unsigned long _startSetTime = micros();
+
+  _pendingMask &= ~(TPL0102_SLEW_A << (ch & 0x01));
+
+  streamRamp(ch, from, to, step, stepDelay, true, _tapPointer[ch]);     // Keeps the last acked tap
+
+#if TPL0102_DEBUG
+  if(_debug){
+
+    Serial.print(F("Ramp done "));
+    Serial.print(potLabel(ch));
+    Serial.println(_tapPointer[ch]);
+
+  }
+#endif
+
+  _setDelay = micros() - _startSetTime;
+  TPL0102_STATS_LATENCY(TPL0102_OP_SET, _setDelay);
+
+  return _tapPointer[ch];
+
+}
+
+// Full-scale sweep 0 -> 255 -> 0 within the same bus session (where the transport chains, see ramp())
+void TPL0102::sweep(uint8_t ch, unsigned int stepDelay) {
+
+  TPL0102_LOCK();
+
+  _selectedChannel = ch;
+
+  unsigned long _startSetTime = micros();
+
+  _pendingMask &= ~(TPL0102_SLEW_A << (ch & 0x01));
+
+  if (streamRamp(ch, 0, TPL0102_TAP_NUMBER, 1, stepDelay, false, _tapPointer[ch]) == 0)
+    streamRamp(ch, TPL0102_TAP_NUMBER - 1, 0, 1, stepDelay, true, _tapPointer[ch]);
+
+  _setDelay = micros() - _startSetTime;
+  TPL0102_STATS_LATENCY(TPL0102_OP_SET, _setDelay);
+
+}
+
+// Returns how long it took to increase the value
+unsigned long TPL0102::incMicros() {
+
+  return _incDelay;
+
+}
+
+// Returns how long it took to decrease the value
+unsigned long TPL0102::decMicros() {
+
+  return _decDelay;
+
+}
+
+// Returns how long it took to set the value
+unsigned long TPL0102::setMicros() {
+
+  return _setDelay;
+
+}
+
+// Keeps a record of the current tap being addressed
+uint8_t TPL0102::taps(uint8_t ch) {
+
+  TPL0102_READER_SELECT(ch);
+
+  return cachedTap(ch);   // value within [1-64] that points to the taps between resistors [0,63]
+}
+
+// Set a desired resistance --> EXTREMELY APPROXIMATE AND THEORETICAL. USE WITH CARE!
+uint8_t TPL0102::setValue(uint8_t ch, float desiredR) {
+
+  return setOhms(ch, (desiredR > 0) ? (uint32_t)(desiredR + 0.5) : 0);
+
+}
+
+// Integer version of setValue(): no float math on the way
+uint8_t TPL0102::setOhms(uint8_t ch, uint32_t desiredR) {
+
+  TPL0102_LOCK();     // _setDelay is shared state too
+
+  int tapTarget;
+
+  unsigned long _startSetTime = micros();
+
+  tapTarget = ohmsToTap(ch, desiredR);
+
+#if TPL0102_DEBUG
+  if (_debug){
+
+  float distance = abs(_tapPointer[ch] - tapTarget);
+
+  Serial.print(F("Distance to target: "));
+  Serial.println(distance);
+
+  Serial.print(F("Target tap: "));
+  Serial.println(tapTarget);
+
+  Serial.print(F("desiredR: "));
+  Serial.println(desiredR);
+
+  Serial.print(F("ch: "));
+  Serial.println(ch);
+
+  Serial.print(F("_tapPointer[ch]: "));
+  Serial.println(_tapPointer[ch]);
+
+  Serial.println();
+
+  }
+#endif
+
+   if (_coalescing) {
+
+    coalesce(ch, tapTarget);    // only the latest value per channel reaches the chip
+
+  } else {
+
+    dataWrite(ch, tapTarget);     // Status in lastError(). Nothing is sent when the chip already has it
+
+  }
+
+  _setDelay = micros() - _startSetTime;
+  TPL0102_STATS_LATENCY(TPL0102_OP_SET, _setDelay);
+
+  return tapTarget;
+
+}
+
+uint8_t TPL0102::setTap(uint8_t ch, uint8_t desiredTap) {
+
+  TPL0102_LOCK();     // _setDelay is shared state too
+
+  int tapTarget;
+
+  unsigned long _startSetTime = micros();
+
+  tapTarget = desiredTap;
+
+#if TPL0102_DEBUG
+  if (_debug){
+
+  float distance = abs(_tapPointer[ch] - tapTarget);
+
+  Serial.print(F("Distance to target: "));
+  Serial.println(distance);
+
+  Serial.print(F("Target tap: "));
+  Serial.println(tapTarget);
+  Serial.println();
+
+
+  }
+#endif
+
+   if (_coalescing) {
+
+    coalesce(ch, tapTarget);    // only the latest value per channel reaches the chip
+
+  } else {
+
+    dataWrite(ch, tapTarget);     // Status in lastError(). Nothing is sent when the chip already has it
+
+  }
+
+  _setDelay = micros() - _startSetTime;
+  TPL0102_STATS_LATENCY(TPL0102_OP_SET, _setDelay);
+
+  return tapTarget;
+
+}
+
+// Set both channels at once. Both wipers change within the same transaction
+uint8_t TPL0102::setTaps(uint8_t tapA, uint8_t tapB) {
+
+  TPL0102_LOCK();     // _setDelay is shared state too
+
+  uint8_t res = 0;
+
+  unsigned long _startSetTime = micros();
+
+#if TPL0102_DEBUG
+  if (_debug){
+
+  Serial.print(F("Target taps: "));
+  Serial.print(tapA);
+  Serial.print(F(", "));
+  Serial.println(tapB);
+  Serial.println();
+
+  }
+#endif
+
+  res = dataWriteBoth(tapA, tapB);     // Sends only the wipers that actually change
+
+  _setDelay = micros() - _startSetTime;
+  TPL0102_STATS_LATENCY(TPL0102_OP_SET, _setDelay);
+
+  return res;
+
+}
+
+// Select a specific channel and return the value that was selected.
+// Dumb-ish but useful(ish)
+
+uint8_t TPL0102::setChannel(uint8_t ch){
+
+  TPL0102_LOCK();
+
+  _selectedChannel = ch;
+
+   if(_ledsDefined && !_ledsDeferred){
+      toggleLED(_selectedChannel);
+    }
+
+  return _selectedChannel;
+
+}
+
+// Deferred: setChannel() only records the channel, updateLEDs() shows it (e.g. once per
+// loop() pass instead of every selection of a fast sweep). Leaving deferred mode updates them
+void TPL0102::deferLEDs(bool defer) {
+
+  _ledsDeferred = defer;
+
+  if (!defer)
+    updateLEDs();
+
+}
+
+// Shows the selected channel. A single comparison when the LEDs already show it
+void TPL0102::updateLEDs() {
+
+  if (_ledsDefined)
+    toggleLED(_selectedChannel);
+
+}
+
+// Turn the pot all the way down
+uint8_t TPL0102::zeroWiper(uint8_t ch) {
+
+  TPL0102_LOCK();
+
+  _selectedChannel = ch;
+
+  return dataWrite(ch, 0);
+
+}
+
+// Turn the pot all the way up
+uint8_t TPL0102::maxWiper(uint8_t ch) {
+
+  TPL0102_LOCK();
+
+  _selectedChannel = ch;
+
+  return dataWrite(ch, TPL0102_TAP_NUMBER);
+
+}
+
+// Get the theoretical current resistance value
+float TPL0102::readValue(uint8_t ch) {
+
+  TPL0102_READER_SELECT(ch);
+
+  return tapToOhms(ch, cachedTap(ch));
+
+}
+
+// Theoretical resistance in ohms, integer version
+uint32_t TPL0102::readOhms(uint8_t ch) {
+
+  TPL0102_READER_SELECT(ch);
+
+  return tapToOhms(ch, cachedTap(ch));
+
+}
+
+// Integer conversions: one multiply and one divide, rounded to the nearest tap / ohm.
+// Exact for every input: round(ohms * 255 / nominal) and round(tap * nominal / 255)
+uint8_t TPL0102::ohmsToTap(uint32_t ohms) {
+
+  if (ohms >= _nominalOhms)
+    return TPL0102_TAP_NUMBER;
+
+  return (ohms * 255UL + _nominalOhms / 2) / _nominalOhms;
+
+}
+
+uint32_t TPL0102::tapToOhms(uint8_t tap) {
+
+  return ((uint32_t)tap * _nominalOhms + 127) / 255;
+
+}
+
+// Channel aware conversions: the calibration table when there is one, the nominal scale otherwise
+uint8_t TPL0102::ohmsToTap(uint8_t ch, uint32_t ohms) {
+
+  const TPL0102Calibration *cal = _calibration[ch & 0x01];
+
+  if (cal == NULL)
+    return ohmsToTap(ohms);
+
+  if (ohms <= cal->ohms[0])
+    return cal->taps[0];
+
+  if (ohms >= cal->ohms[cal->count - 1])
+    return cal->taps[cal->count - 1];
+
+  // Binary search for the segment holding ohms, then linear interpolation: O(log n)
+  uint8_t low = 0;
+  uint8_t high = cal->count - 1;
+
+  while (high - low > 1) {
+
+    uint8_t mid = (low + high) / 2;
+
+    if (cal->ohms[mid] <= ohms)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  uint32_t span = cal->ohms[high] - cal->ohms[low];
+  uint8_t tapSpan = cal->taps[high] - cal->taps[low];
+
+  return cal->taps[low] + ((ohms - cal->ohms[low]) * tapSpan + span / 2) / span;
+
+}
+
+uint32_t TPL0102::tapToOhms(uint8_t ch, uint8_t tap) {
+
+  const TPL0102Calibration *cal = _calibration[ch & 0x01];
+
+  if (cal == NULL)
+    return tapToOhms(tap);
+
+  if (tap <= cal->taps[0])
+    return cal->ohms[0];
+
+  if (tap >= cal->taps[cal->count - 1])
+    return cal->ohms[cal->count - 1];
+
+  uint8_t low = 0;
+  uint8_t high = cal->count - 1;
+
+  while (high - low > 1) {
+
+    uint8_t mid = (low + high) / 2;
+
+    if (cal->taps[mid] <= tap)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  uint8_t tapSpan = cal->taps[high] - cal->taps[low];
+
+  return cal->ohms[low] + ((cal->ohms[high] - cal->ohms[low]) * (tap - cal->taps[low]) + tapSpan / 2) / tapSpan;
+
+}
+
+// Use measured points for a channel. The table is owned by the caller and must outlive its use.
+// Points need strictly increasing taps and ohms, and a checksum from sealCalibration().
+// NULL goes back to the nominal (theoretical) conversion. Returns false if the table is rejected
+bool TPL0102::setCalibration(uint8_t ch, const TPL0102Calibration *cal) {
+
+  if (cal != NULL) {
+
+    if ((cal->version != TPL0102_CAL_VERSION) || (cal->count < 2) || (cal->count > TPL0102_CAL_MAX_POINTS))
+      return false;
+
+    if (cal->checksum != calibrationChecksum(*cal))
+      return false;
+
+    for (uint8_t i = 1; i < cal->count; i++) {
+
+      if ((cal->taps[i] <= cal->taps[i - 1]) || (cal->ohms[i] <= cal->ohms[i - 1]))
+        return false;
+    }
+  }
+
+  _calibration[ch & 0x01] = cal;
+
+  return true;
+
+}
+
+// Fill the header fields of a table built at run time (e.g. from ADC measurements), ready to be
+// stored with EEPROM.put() and loaded again with EEPROM.get() + setCalibration()
+void TPL0102::sealCalibration(TPL0102Calibration &cal) {
+
+  cal.version = TPL0102_CAL_VERSION;
+  cal.checksum = calibrationChecksum(cal);
+
+}
+
+// Fletcher-16 over the points in use
+uint16_t TPL0102::calibrationChecksum(const TPL0102Calibration &cal) {
+
+  uint16_t sum1 = cal.count;
+  uint16_t sum2 = cal.count;
+
+  for (uint8_t i = 0; (i < cal.count) && (i < TPL0102_CAL_MAX_POINTS); i++) {
+
+    const uint8_t *point = (const uint8_t *)&cal.ohms[i];
+
+    sum1 = (sum1 + cal.taps[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+
+    for (uint8_t b = 0; b < sizeof(cal.ohms[i]); b++) {
+      sum1 = (sum1 + point[b]) % 255;
+      sum2 = (sum2 + sum1) % 255;
+    }
+  }
+
+  return (sum2 << 8) | sum1;
+
+}
+
+// Computed once per nominal value: the conversions only need it in whole ohms (1 ohm minimum,
+// TPL0102_MAX_NOMINAL_OHMS maximum so the integer math stays within 32 bits)
+void TPL0102::setScales(float nomRes) {
+
+  if (nomRes < 1)
+    _nominalOhms = 1;
+  else if (nomRes > TPL0102_MAX_NOMINAL_OHMS)
+    _nominalOhms = TPL0102_MAX_NOMINAL_OHMS;
+  else
+    _nominalOhms = (uint32_t)(nomRes + 0.5);
+}
+
+// Streams the steps of a ramp. With repeated START (TPL0102_CHAIN_SENT) only the very last step may
+// release the bus. A deferred chain (TPL0102_CHAIN_DEFERRED) is sent every TPL0102_CHAIN_MAX_STEPS
+// steps, after every step with a stepDelay (the pacing has to reach the bus) and at the end: its 0
+// only means queued, so the cache moves when the job that holds the step is acked.
+// Otherwise every step is its own STOP-terminated write.
+// A failed step ends the ramp: lastTap holds the last value the chip acked
+uint8_t TPL0102::streamRamp(uint8_t ch, uint8_t from, uint8_t to, uint8_t step, unsigned int stepDelay, bool stop, uint8_t &lastTap) {
+
+  if ((_nvRestoreACR != TPL0102_NV_IDLE) && nonVolatileBusy())
+    return TPL0102_NV_BUSY;     // ramp(), sweep() and slews wait for the save too
+
+  uint8_t chaining = _transport->chaining();
+  uint8_t queued = 0;
+  uint8_t wiperPointer = (ch == CHB) ? WRB : WRA;
+  uint8_t cacheBit = (ch == CHB) ? TPL0102_CACHE_B : TPL0102_CACHE_A;
+  int delta = (step == 0) ? 1 : step;
+  int tap = from;
+
+  if (to < from)
+    delta = -delta;
+
+  while (true) {
+
+    bool lastStep = (tap == to);
+    bool release;
+
+    if (chaining == TPL0102_CHAIN_SENT)
+      release = lastStep && stop;     // repeated START between steps
+    else if (chaining == TPL0102_CHAIN_DEFERRED)
+      release = lastStep || stepDelay || (++queued >= TPL0102_CHAIN_MAX_STEPS);
+    else
+      release = true;
+
+    uint8_t val = tap;
+    uint8_t res = _transport->write(address, wiperPointer, &val, 1, release);
+    TPL0102_STATS_RESULT(res);
+
+    _lastError = res;
+
+    if (res != 0) {
+      _cacheValid &= ~cacheBit;
+      return res;
+    }
+
+    if (release || (chaining == TPL0102_CHAIN_SENT)) {
+
+      lastTap = tap;
+      _cacheValid |= cacheBit;
+      queued = 0;
+    }
+
+    if (lastStep)
+      return 0;
+
+    if (stepDelay)
+      delayMicroseconds(stepDelay);
+
+    tap += delta;
+
+    if (((delta > 0) && (tap > to)) || ((delta < 0) && (tap < to)))
+      tap = to;
+  }
+}
+
+// Single transaction write of consecutive registers (auto-increment) with bounded retry.
+// The success path costs one comparison on top of the transaction itself
+uint8_t TPL0102::writeRegisters(uint8_t startReg, const uint8_t *data, uint8_t len) {
+
+  TPL0102_LOCK();
+
+  uint8_t res;
+  uint8_t attempt = 0;
+
+  while (true) {
+
+    res = _transport->write(address, startReg, data, len, true);     // stop transmitting
+
+    TPL0102_STATS_RESULT(res);
+
+    if ((res == 0) || (attempt++ >= _retries))
+      break;
+
+    if (res >= 4)
+      recoverBus();     // Other error / timeout: the bus itself may be stuck
+  }
+
+  _lastError = res;
+
+  return res;
+
+}
+
+// Read back the wiper registers after every Nth successful write (0: off, 1: every write)
+void TPL0102::setVerify(uint8_t everyN) {
+
+  _verifyEvery = everyN;
+  _verifyCounter = 0;
+
+}
+
+// Re-sync both channels from the chip in a single burst. Returns the I2C result
+uint8_t TPL0102::refresh() {
+
+  TPL0102_LOCK();
+
+  uint8_t wipers[2];
+
+  if (readRegisters(WRA, wipers, 2) == 2) {
+    _tapPointer[0] = wipers[0];
+    _tapPointer[1] = wipers[1];
+    _cacheValid |= TPL0102_CACHE_A | TPL0102_CACHE_B;
+  }
+
+  return _lastError;
+
+}
+
+// Forget what the chip is believed to hold: the next write of every register goes out,
+// even when it repeats the cached value (e.g. after the chip lost power on its own)
+void TPL0102::invalidateCache() {
+
+  TPL0102_LOCK();
+
+  _cacheValid = 0;
+
+}
+
+// Wipers, ACR and last result of one consistent moment. Never blocks: in thread-safe builds it is
+// a single atomic load, so telemetry tasks can call it while another task owns the bus
+TPL0102Snapshot TPL0102::snapshot() {
+
+  TPL0102Snapshot snap;
+
+#if TPL0102_LOCKING
+  uint32_t packed = _snapshot.load(std::memory_order_acquire);
+
+  memcpy(&snap, &packed, sizeof(snap));
+#else
+  snap.tap[0] = _tapPointer[0];
+  snap.tap[1] = _tapPointer[1];
+  snap.acr = _acr;
+  snap.lastError = _lastError;
+#endif
+
+  return snap;
+
+}
+
+uint8_t TPL0102::cachedTap(uint8_t ch) {
+
+#if TPL0102_LOCKING
+  return snapshot().tap[ch & 0x01];
+#else
+  return _tapPointer[ch];
+#endif
+
+}
+
+#if TPL0102_LOCKING
+// Called by Guard with the bus mutex still held
+void TPL0102::publishSnapshot() {
+
+  TPL0102Snapshot snap;
+  uint32_t packed;
+
+  snap.tap[0] = _tapPointer[0];
+  snap.tap[1] = _tapPointer[1];
+  snap.acr = _acr;
+  snap.lastError = _lastError;
+
+  memcpy(&packed, &snap, sizeof(packed));
+  _snapshot.store(packed, std::memory_order_release);
+
+}
+
+static const void *_lockedBuses[TPL0102_MAX_BUSES];
+static SemaphoreHandle_t _busMutexes[TPL0102_MAX_BUSES];
+
+// One recursive mutex per bus: nested calls (setTap -> dataWrite -> writeRegisters) take it again
+SemaphoreHandle_t TPL0102BusLock::forBus(const void *bus) {
+
+  for (uint8_t i = 0; i < TPL0102_MAX_BUSES; i++) {
+
+    if (_lockedBuses[i] == bus)
+      return _busMutexes[i];
+
+    if (_lockedBuses[i] == NULL) {
+      _busMutexes[i] = xSemaphoreCreateRecursiveMutex();
+      _lockedBuses[i] = bus;
+      return _busMutexes[i];
+    }
+  }
+
+  return NULL;      // More buses than TPL0102_MAX_BUSES: left unlocked
+}
+
+TPL0102BusLock::TPL0102BusLock(const void *bus) : _mutex(forBus(bus)) {
+
+  if (_mutex != NULL)
+    xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+
+}
+
+TPL0102BusLock::~TPL0102BusLock() {
+
+  if (_mutex != NULL)
+    xSemaphoreGiveRecursive(_mutex);
+
+}
+#endif
+
+bool TPL0102::verifyDue() {
+
+  if (_verifyEvery == 0)
+    return false;
+
+  if (++_verifyCounter < _verifyEvery)
+    return false;
+
+  _verifyCounter = 0;
+
+  return true;
+
+}
+
+// Compare what was written with what the chip holds. On a mismatch the cache takes the
+// chip value and TPL0102_VERIFY_MISMATCH is returned, so callers leave it untouched
+uint8_t TPL0102::verifyWipers(uint8_t ch, uint8_t len, const uint8_t *expected) {
+
+  uint8_t wipers[2];
+  uint8_t res = 0;
+
+  if (readRegisters((ch == CHB) ? WRB : WRA, wipers, len) != len)
+    return _lastError;
+
+  for (uint8_t i = 0; i < len; i++) {
+
+    if (wipers[i] != expected[i]) {
+
+      _tapPointer[ch + i] = wipers[i];
+      res = TPL0102_VERIFY_MISMATCH;
+
+#if TPL0102_STATS
+      _stats.verifyMismatches++;
+#endif
+    }
+  }
+
+  _lastError = res;
+
+  return res;
+
+}
+
+// Burst read of consecutive registers. The register pointer auto-increments after
+// every byte, so a whole run costs a single write-pointer/repeated-start/read transaction.
+// Returns the number of bytes actually received
+uint8_t TPL0102::readRegisters(uint8_t startReg, uint8_t *buf, uint8_t len) {
+
+  TPL0102_LOCK();
+
+  TPL0102_STATS_START(_startReadTime);
+
+  uint8_t count;
+  uint8_t res;
+  uint8_t attempt = 0;
+
+  while (true) {
+
+    res = _transport->read(address, startReg, buf, len, count);     // short read counts as a bus error
+
+    TPL0102_STATS_RESULT(res);
+
+    if ((res == 0) || (attempt++ >= _retries))
+      break;
+
+    if (res >= 4)
+      recoverBus();
+  }
+
+  _lastError = res;
+
+  TPL0102_STATS_STOP(TPL0102_OP_READ, _startReadTime);
+
+  return count;
+
+}
+
+// Check the values from the system registers
+void TPL0102::readRegistersStatus() {
+
+  TPL0102_LOCK();
+
+  // Holds the initial values from Registers: IVRA([0]), IVRB([1]) and ACR([2]).
+  // Factory values are kept for whatever cannot be read
+  uint8_t _initialState[3] = {(uint8_t)FACTORY_WIPER_POSITION, (uint8_t)FACTORY_WIPER_POSITION, SHUTDOWN_MASK};
+
+  // IVRA and IVRB are consecutive: one burst. ACR lives at 0x10: second burst
+  _cacheValid = 0;
+
+  if (readRegisters(IVRA, &_initialState[0], 2) == 2)
+    _cacheValid |= TPL0102_CACHE_A | TPL0102_CACHE_B;     // WR loads from IVR at power-up
+
+  if (readRegisters(ACR, &_initialState[2], 1) == 1)
+    _cacheValid |= TPL0102_CACHE_ACR;
+
+  _tapPointer[0] = _initialState[0];
+  _tapPointer[1] = _initialState[1];
+  _acr = _initialState[2] & ~WIP_MASK;    // ACR shadow
+
+#if TPL0102_DEBUG
+  if (_debug) {
+
+    for (int pos = 0; pos < 3; pos++) {
+
+      Serial.println(F(" ******************** "));
+
+      Serial.print(registerLabel(pos));
+      Serial.print(_initialState[pos], HEX);
+      Serial.print(F(" (HEX)"));
+
+      Serial.print(_initialState[pos], DEC);
+      Serial.print(F(" (DEC)"));
+      Serial.println(F(" "));
+      Serial.println(F(" ******************** "));
+    }
+  }
+#endif
+
+}
+
+// Check the values from the user registers
+void TPL0102::readDummyRegStatus() {
+
+#if TPL0102_DEBUG
+  uint8_t dummyRegs[GENERAL_PURPOSE_END - GENERAL_PURPOSE_START + 1];
+  uint8_t count = readRegisters(GENERAL_PURPOSE_START, dummyRegs, sizeof(dummyRegs));
+
+  if (_debug == true) {
+
+    for (uint8_t i = 0; i < count; i++) {
+
+      Serial.print(F("Dummy ["));
+      Serial.print(GENERAL_PURPOSE_START + i, HEX);
+      Serial.print(F("]: "));
+
+      Serial.print(dummyRegs[i], HEX);
+      Serial.print(F(" (HEX)"));
+
+      Serial.print(dummyRegs[i], DEC);
+      Serial.print(F(" (DEC)"));
+      Serial.println(F(" "));
+    }
+  }
+#endif
+}
+
+#if TPL0102_STATS
+// Snapshot of the latency histograms and error counters
+const TPL0102Stats &TPL0102::getStats() {
+
+  return _stats;
+
+}
+
+void TPL0102::resetStats() {
+
+  memset(&_stats, 0, sizeof(_stats));
+
+  for (uint8_t op = 0; op < TPL0102_OP_COUNT; op++)
+    _stats.op[op].minUs = 0xFFFFFFFF;
+
+}
+
+void TPL0102::recordLatency(uint8_t op, unsigned long us) {
+
+  TPL0102OpStats &stats = _stats.op[op];
+  uint8_t bucket = 0;
+
+  stats.count++;
+  stats.totalUs += us;
+
+  if (us < stats.minUs)
+    stats.minUs = us;
+
+  if (us > stats.maxUs)
+    stats.maxUs = us;
+
+  for (unsigned long limit = TPL0102_STATS_FIRST_BUCKET_US; (us >= limit) && (bucket < TPL0102_STATS_BUCKETS - 1); limit <<= 1)
+    bucket++;
+
+  if (stats.histogram[bucket] < 0xFFFF)
+    stats.histogram[bucket]++;
+
+}
+
+void TPL0102::recordResult(uint8_t res) {
+
+  _stats.transactions++;
+
+  if ((res == 2) || (res == 3))
+    _stats.nacks++;
+  else if (res != 0)
+    _stats.busErrors++;
+
+}
+#endif
+
+#if TPL0102_DEBUG >= 2
+// Trace ring shared by every instance. Recording is a handful of stores: nothing waits on Serial
+TPL0102::TraceEntry TPL0102::_trace[TPL0102_TRACE_DEPTH];
+uint8_t TPL0102::_traceHead = 0;
+uint8_t TPL0102::_traceCount = 0;
+
+void TPL0102::traceEvent(uint8_t op, uint8_t ch, uint8_t val, uint8_t res) {
+
+  TraceEntry &entry = _trace[_traceHead];
+
+  entry.time = micros();
+  entry.address = address;
+  entry.op = op;
+  entry.ch = ch;
+  entry.val = val;
+  entry.result = res;
+
+  _traceHead = (_traceHead + 1) % TPL0102_TRACE_DEPTH;
+
+  if (_traceCount < TPL0102_TRACE_DEPTH)
+    _traceCount++;      // Oldest entries are overwritten once the ring is full
+
+}
+
+// Pop the oldest recorded event. Returns false when the ring is empty
+bool TPL0102::readTrace(TraceEntry &entry) {
+
+  if (_traceCount == 0)
+    return false;
+
+  uint8_t tail = (_traceHead + TPL0102_TRACE_DEPTH - _traceCount) % TPL0102_TRACE_DEPTH;
+
+  entry = _trace[tail];
+  _traceCount--;
+
+  return true;
+
+}
+
+// Print (and empty) the ring. Call it from a non time-critical place
+void TPL0102::dumpTrace(Print &out) {
+
+  TraceEntry entry;
+
+  while (readTrace(entry)) {
+
+    out.print(entry.time);
+    out.print(F(" us 0x"));
+    out.print(entry.address, HEX);
+    out.print(F(" op "));
+    out.print(entry.op);
+    out.print(F(" ch "));
+    out.print(entry.ch);
+    out.print(F(" val "));
+    out.print(entry.val);
+    out.print(F(" res "));
+    out.println(entry.result);
+  }
+}
+#endif
+
+// Switch ON/OFF the LEDs attached to the board or
+// close to the pots being used. Change-driven: the pins are only written when the channel differs
+void TPL0102::toggleLED(uint8_t ch){
+
+  if ((ch > CHB) || (ch == _ledShown))
+    return;
+
+  if (_ledShown == TPL0102_LED_UNSET) {     // First update: set the pins up now
+
+    pinMode(_boardLEDs[0], OUTPUT);
+    pinMode(_boardLEDs[1], OUTPUT);
+  }
+
+  ledWrite(_boardLEDs[ch], HIGH);
+  ledWrite(_boardLEDs[ch ^ 0x01], LOW);
+
+  _ledShown = ch;
+
+}
+
+// Direct output register write on AVR (no PWM / timer checks), the GPIO driver on the ESP32
+void TPL0102::ledWrite(uint8_t pin, uint8_t level) {
+
+#if defined(__AVR__)
+  uint8_t port = digitalPinToPort(pin);
+
+  if (port == NOT_A_PIN)
+    return;
+
+  volatile uint8_t *out = portOutputRegister(port);
+  uint8_t mask = digitalPinToBitMask(pin);
+  uint8_t oldSREG = SREG;
+
+  cli();      // Read-modify-write of a port an ISR may share
+
+  if (level)
+    *out |= mask;
+  else
+    *out &= ~mask;
+
+  SREG = oldSREG;
+#elif defined(ESP32)
+  gpio_set_level((gpio_num_t)pin, level);     // Single W1TS / W1TC register write
+#else
+  digitalWrite(pin, level);
+#endif
+
 }
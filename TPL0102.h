@@ -8,6 +8,7 @@
                         1.2.3 - June - Two LEDs can be integrated as part of the instantiation. The library manages these as a channel selection indicator.
                                      This feature is used by the new development boards available in Tindie
                         1.2.4 - added a new overloaded setup for overriding the resistance value . General cleanup
+                        1.2.5 - The speed argument of begin() is now applied to the bus (it was hard-coded to STANDARD). Added setBusSpeed()
                                    
     License: MIT                
 
@@ -18,6 +19,7 @@
 
 #include "Arduino.h"
 #include <Wire.h>
+#include "TPL0102Transport.h"
 #if defined(__AVR__)
 #include <avr/pgmspace.h>
 #elif ESP32
@@ -28,6 +30,9 @@
 #define TPL0102_DEFAULT_TAP_COUNT 128.0     // Half way resistance
 #define TPL0102_NOMINAL_RESISTANCE 97270    // 100000 theoretical --> Real value measured using maxPot method
 #define TPL0102_WIPER_RESISTANCE 39.5   // 75 typical (According to the datasheet)
+// Integer ohmsToTap() / tapToOhms(): ohms * 255 and tap * nominal stay within 32 bits for nominal
+// values up to ~16.8 MOhm, so both round exactly (no scale quantization)
+#define TPL0102_MAX_NOMINAL_OHMS 16843009UL     // 0xFFFFFFFF / 255
 #define FACTORY_WIPER_POSITION 128.0  //0x80
 #define STANDARD 100000
 #define FAST 400000     // Maximum supported I2C speed
@@ -42,14 +47,156 @@
 // B5: WIP[0/1](R) --> Non-volatile operation not in progress; 1: Non-volatile operation in progress (not possible to write to WR or ACR while WIP = 1)
 // B4-B0: 0
 #define SHUTDOWN_MASK 0x40 // Turn off bit 6
+#define VOL_MASK 0x80 // Bit 7
+#define WIP_MASK 0x20 // Bit 5 (read only)
 #define VOLATILE_REG_ACCESSIBLE 0xC0
 #define NON_VOLATILE_REG_ACCESSIBLE 0x40   // Bit mask: 0x80  (|= (OR to set) or ^= (XOR to remove))
 #define GENERAL_PURPOSE_START 2//0x02
 #define GENERAL_PURPOSE_END   14 //0x0E
 
+// Debug level, set as a build flag (e.g. -DTPL0102_DEBUG=1):
+//   0: no debug code is compiled at all (default)
+//   1: Serial reports, enabled per instance with the dbg constructors
+//   2: same as 1 plus a non-blocking trace ring of every bus write (readTrace() / dumpTrace())
+#ifndef TPL0102_DEBUG
+#define TPL0102_DEBUG 0
+#endif
+#define TPL0102_TRACE_DEPTH 16
+
+#define TPL0102_TRACE_WRITE 0
+#define TPL0102_TRACE_WRITE_BOTH 1    // ch holds the POT A value
+#define TPL0102_TRACE_ACR 2
+
+#if TPL0102_DEBUG >= 2
+#define TPL0102_TRACE(op, ch, val, res) traceEvent(op, ch, val, res)
+#else
+#define TPL0102_TRACE(op, ch, val, res)
+#endif
+
+// Latency/error statistics, also a build flag (-DTPL0102_STATS=1). Off by default: costs
+// 2 micros() calls per timed operation and sizeof(TPL0102Stats) bytes of RAM per instance
+#ifndef TPL0102_STATS
+#define TPL0102_STATS 0
+#endif
+#define TPL0102_STATS_BUCKETS 8       // Histogram buckets: < 50, < 100, < 200 ... < 3200, >= 3200 usec
+#define TPL0102_STATS_FIRST_BUCKET_US 50
+
+#define TPL0102_OP_WRITE 0    // dataWrite() / dataWriteBoth()
+#define TPL0102_OP_INC 1
+#define TPL0102_OP_DEC 2
+#define TPL0102_OP_SET 3      // setTap() / setTaps() / setValue() / setOhms() / ramp()
+#define TPL0102_OP_SWITCH 4   // ACR writes: switchPot() / setVolatileAccess()
+#define TPL0102_OP_READ 5     // readRegisters()
+#define TPL0102_OP_COUNT 6
+
+#if TPL0102_STATS
+#define TPL0102_STATS_START(var) unsigned long var = micros()
+#define TPL0102_STATS_STOP(op, var) recordLatency(op, micros() - var)
+#define TPL0102_STATS_LATENCY(op, us) recordLatency(op, us)
+#define TPL0102_STATS_RESULT(res) recordResult(res)
+#else
+#define TPL0102_STATS_START(var)
+#define TPL0102_STATS_STOP(op, var)
+#define TPL0102_STATS_LATENCY(op, us)
+#define TPL0102_STATS_RESULT(res)
+#endif
+
+// Thread-safe mode for FreeRTOS firmware (-DTPL0102_THREAD_SAFE=1, ESP32 only). Every transaction holds a
+// recursive mutex shared by all the drivers on the same bus (TPL0102Transport::busKey()); readers get a lock-free snapshot()
+// and write nothing: taps() / readValue() / readOhms() / wiper() do not select the channel in this mode
+#ifndef TPL0102_THREAD_SAFE
+#define TPL0102_THREAD_SAFE 0
+#endif
+#if TPL0102_THREAD_SAFE && defined(ESP32)
+#include <atomic>
+#define TPL0102_LOCKING 1
+#define TPL0102_MAX_BUSES 2           // Wire and Wire1
+#define TPL0102_LOCK() Guard _guard(this)
+#define TPL0102_BUS_LOCK(wire) TPL0102BusLock _busLock(wire)
+#define TPL0102_READER_SELECT(ch)
+#else
+#define TPL0102_LOCKING 0
+#define TPL0102_LOCK()
+#define TPL0102_BUS_LOCK(wire)
+#define TPL0102_READER_SELECT(ch) _selectedChannel = (ch)
+#endif
+
+#define TPL0102_DEFAULT_RETRIES 2   // Extra attempts after a failed transaction
+#define TPL0102_VERIFY_MISMATCH 6   // Status after Wire's 0-5: written and read back wiper differ
+#define TPL0102_NV_BUSY 7           // A non-volatile save is still in progress: wiper / ACR writes are refused
+#define TPL0102_NV_TIMEOUT 8        // WIP did not clear in time
+#define TPL0102_INVALID_PRESET 9    // TPL0102Scene: no preset with that id
+#define TPL0102_NV_TIMEOUT_MS 50    // Worst case EEPROM write, polling usually ends much earlier
+#define TPL0102_NV_IDLE 0xFF        // No save in progress (WIP never lands in the ACR shadow)
+
+#define TPL0102_ASYNC_QUEUE_SIZE 4  // Queued async writes (one slot is kept free)
+
+#define TPL0102_CACHE_A 0x01        // Shadow cache validity bits: the cached value matches the chip
+#define TPL0102_CACHE_B 0x02
+#define TPL0102_CACHE_ACR 0x04
+
+#define TPL0102_LED_UNSET 0xFF       // LED pins not set up yet (nothing shown)
+
+#define TPL0102_SLEW_A 0x04         // Pending mask: channel slewing towards its pending tap (setTapSlewed)
+#define TPL0102_SLEW_B 0x08
+
 #define CHA 0
 #define CHB 1
 
+// Per channel calibration: measured (tap, ohms) points, strictly increasing.
+// Plain data: it can be kept in EEPROM (EEPROM.put/get) or copied from flash (memcpy_P) at boot
+#define TPL0102_CAL_MAX_POINTS 9
+#define TPL0102_CAL_VERSION 1
+
+struct TPL0102Calibration{
+  uint8_t version;
+  uint8_t count;
+  uint8_t taps[TPL0102_CAL_MAX_POINTS];
+  uint32_t ohms[TPL0102_CAL_MAX_POINTS];
+  uint16_t checksum;
+};
+
+// The cached state in one 32-bit word: consistent across both wipers, readable from any task
+struct TPL0102Snapshot{
+  uint8_t tap[2];
+  uint8_t acr;
+  uint8_t lastError;
+};
+
+#if TPL0102_LOCKING
+// Bus mutex, held from constructor to destructor. TPL0102Bus and user code can take it too
+// to keep their own transactions on a shared bus in one piece
+class TPL0102BusLock {
+
+  public:
+    explicit TPL0102BusLock(const void *bus);
+    ~TPL0102BusLock();
+    static SemaphoreHandle_t forBus(const void *bus);    // Created on first use: call begin() before the tasks start
+
+  private:
+    SemaphoreHandle_t _mutex;
+};
+#endif
+
+struct TPL0102OpStats{
+  unsigned long count;
+  unsigned long minUs;
+  unsigned long maxUs;
+  unsigned long totalUs;
+  uint16_t histogram[TPL0102_STATS_BUCKETS];
+
+  unsigned long meanUs(void) const { return count ? totalUs / count : 0; }
+};
+
+struct TPL0102Stats{
+  TPL0102OpStats op[TPL0102_OP_COUNT];
+  unsigned long transactions;
+  unsigned long nacks;        // endTransmission() 2 (address) or 3 (data)
+  unsigned long busErrors;    // any other non-zero result, or a short read
+  unsigned long verifyMismatches;
+  unsigned long suppressedWrites;   // No-op writes the shadow cache kept off the bus
+};
+
 class TPL0102 {
 
   public:
@@ -62,18 +209,18 @@ class TPL0102 {
 
     //Constants
 
-   /* Declared here thanks to the GREAT help from my buddies on: https://stackoverflow.com/questions/11072244/c-multiple-definitions-of-a-variable*/
-    const char LBL_POT_A[8] PROGMEM = "POT A: ";
-    const char LBL_POT_B[8] PROGMEM = "POT B: ";
+    // Flash-resident labels, shared by every instance. Print them through potLabel() / registerLabel()
+    static const char LBL_POT_A[8] PROGMEM;
+    static const char LBL_POT_B[8] PROGMEM;
 
-    const char LBL_REG_IVRA[7] PROGMEM = "IVRA: ";
-    const char LBL_REG_IVRB[7] PROGMEM = "IVRB: ";
-    const char LBL_REG_ACR[7] PROGMEM = "ACR_: ";
+    static const char LBL_REG_IVRA[7] PROGMEM;
+    static const char LBL_REG_IVRB[7] PROGMEM;
+    static const char LBL_REG_ACR[7] PROGMEM;
 
-    const char *const POT_LABELS[2] PROGMEM = {LBL_POT_A,LBL_POT_B};
-    const char *const REGISTER_LABELS[3] PROGMEM = {LBL_REG_IVRA, LBL_REG_IVRB, LBL_REG_ACR};
+    static const char *const POT_LABELS[2] PROGMEM;
+    static const char *const REGISTER_LABELS[3] PROGMEM;
 
-    const float nominal = TPL0102_NOMINAL_RESISTANCE;
+    static constexpr float nominal = TPL0102_NOMINAL_RESISTANCE;
 
     // Destructor 
 
@@ -84,51 +231,211 @@ class TPL0102 {
     struct channels{
       byte A = CHA;
       byte B = CHB;
-    }channel;
+    };
+    static const channels channel;
     
     uint16_t address;
     uint32_t I2CSpeed = STANDARD;
     // Methods:
+    static const __FlashStringHelper *potLabel(uint8_t chan);
+    static const __FlashStringHelper *registerLabel(uint8_t reg);
     void begin(uint16_t addr, uint32_t speed);
     void begin(uint16_t addr, float nominalRes,uint32_t speed);
+    void begin(TwoWire &wirePort, uint16_t addr, uint32_t speed);
+    void begin(TwoWire &wirePort, uint16_t addr, uint32_t speed, int sda, int scl);
+    void begin(TwoWire &wirePort, uint16_t addr, float nominalRes, uint32_t speed);
+    void begin(TwoWire &wirePort, uint16_t addr, float nominalRes, uint32_t speed, int sda, int scl);
+    void begin(TPL0102Transport &transport, uint16_t addr, uint32_t speed);
+    void begin(TPL0102Transport &transport, uint16_t addr, float nominalRes, uint32_t speed, int sda, int scl);
+    void beginFast(uint16_t addr, const TPL0102Snapshot &state, uint32_t speed, bool lazyVerify = true);
+    void beginFast(TwoWire &wirePort, uint16_t addr, float nominalRes, uint32_t speed, const TPL0102Snapshot &state, bool lazyVerify = true);
+    void beginFast(TPL0102Transport &transport, uint16_t addr, float nominalRes, uint32_t speed, const TPL0102Snapshot &state, bool lazyVerify = true);
+    uint8_t verifyState(void);
+    void setBusSpeed(uint32_t speed);
     uint8_t taps(uint8_t chan);
     float wiper(uint8_t chan);
-    void inc(uint8_t chan);
-    void dec(uint8_t chan);
-    void zeroWiper(uint8_t chan);
-    void maxWiper(uint8_t chan);
+    uint8_t inc(uint8_t chan);
+    uint8_t dec(uint8_t chan);
+    uint8_t zeroWiper(uint8_t chan);
+    uint8_t maxWiper(uint8_t chan);
     uint8_t setChannel(uint8_t chan);
+    void deferLEDs(bool defer);
+    void updateLEDs(void);
     float readValue(uint8_t chan);
     uint8_t setValue(uint8_t chan, float val);
+    uint8_t setOhms(uint8_t chan, uint32_t ohms);
+    uint32_t readOhms(uint8_t chan);
+    uint8_t ohmsToTap(uint32_t ohms);
+    uint32_t tapToOhms(uint8_t tap);
+    uint8_t ohmsToTap(uint8_t chan, uint32_t ohms);
+    uint32_t tapToOhms(uint8_t chan, uint8_t tap);
+    bool setCalibration(uint8_t chan, const TPL0102Calibration *cal);
+    static void sealCalibration(TPL0102Calibration &cal);
+    static uint16_t calibrationChecksum(const TPL0102Calibration &cal);
     uint8_t setTap(uint8_t chan, uint8_t val);
+    uint8_t setTaps(uint8_t valA, uint8_t valB);
+    uint8_t ramp(uint8_t chan, uint8_t from, uint8_t to, uint8_t step = 1, unsigned int stepDelay = 0);
+    void sweep(uint8_t chan, unsigned int stepDelay = 0);
     unsigned long incMicros(void);
     unsigned long decMicros(void);
     unsigned long setMicros(void);
-    void switchPot(uint8_t chan, uint8_t state);
-    void dataWrite(uint8_t ch, uint8_t val);
+    uint8_t switchPot(uint8_t chan, uint8_t state);
+    uint8_t setVolatileAccess(bool volatileRegs);
+    uint8_t wakeWithTaps(uint8_t tapA, uint8_t tapB);
+    uint8_t resyncACR(void);
+    uint8_t saveToNonVolatile(uint8_t chan);
+    uint8_t saveBoth(void);
+    uint8_t saveToNonVolatileAsync(uint8_t chan);
+    uint8_t saveBothAsync(void);
+    bool nonVolatileBusy(void);
+    uint8_t acr(void);
+    uint8_t dataWrite(uint8_t ch, uint8_t val);
+    uint8_t dataWriteBoth(uint8_t valA, uint8_t valB);
+    uint8_t readRegisters(uint8_t startReg, uint8_t *buf, uint8_t len);
+    uint8_t writeRegisters(uint8_t startReg, const uint8_t *data, uint8_t len);
+    void setRetries(uint8_t retries);
+    uint8_t lastError(void);
+    bool recoverBus(void);
+    void setVerify(uint8_t everyN);
+    uint8_t refresh(void);
+    TPL0102Snapshot snapshot(void);
+    void invalidateCache(void);
+
+    // Async (queued) writes
+    typedef void (*AsyncCallback)(uint8_t ch, uint8_t val, uint8_t result);
+    bool setTapAsync(uint8_t chan, uint8_t val);
+    uint8_t poll(void);
+    uint8_t asyncPending(void);
+    void onAsyncComplete(AsyncCallback cb);
+    void setCoalescing(bool enable, unsigned long flushInterval = 0);
+    uint8_t flush(void);
+    uint8_t setTapSlewed(uint8_t chan, uint8_t target, uint8_t maxStep, unsigned long intervalUs);
+    bool slewing(uint8_t chan);
+    void stopSlew(uint8_t chan);
+#if TPL0102_LOCKING
+    // Needs TPL0102_THREAD_SAFE: poll() on another core shares the pending and cache state with loop()
+    bool startAsyncTask(uint8_t core = 0, uint8_t priority = 1);
+#endif
+
+#if TPL0102_STATS
+    const TPL0102Stats &getStats(void);
+    void resetStats(void);
+#endif
+
+#if TPL0102_DEBUG >= 2
+    struct TraceEntry{
+      unsigned long time;
+      uint8_t address;
+      uint8_t op;
+      uint8_t ch;
+      uint8_t val;
+      uint8_t result;
+    };
+    static bool readTrace(TraceEntry &entry);
+    static void dumpTrace(Print &out);
+#endif
 
   private:
 
-    uint8_t _pinLedA;
-    uint8_t _pinLedB;
+    // Footprint target: sizeof(TPL0102) <= 80 bytes on AVR (default build flags), enforced by the static_assert
+    // after the class. 69 bytes once the constants moved to flash; the calibration pointers (+4) and the status,
+    // verify, NV save, cache and slew bytes added since make up the rest (the 8 bytes of slew timebase came out
+    // of the dropped Q22/Q8 scales). Raise it only with the change that needs the bytes. Only per-device state lives here,
+    // constants belong in flash (static PROGMEM / constexpr)
+    TPL0102Transport *_transport = TPL0102WireTransport::forBus(&Wire);
+    int8_t _sdaPin = -1;      // Needed by recoverBus()
+    int8_t _sclPin = -1;
+    uint8_t _retries = TPL0102_DEFAULT_RETRIES;
+    uint8_t _lastError = 0;
+    uint8_t _verifyEvery = 0;
+    uint8_t _verifyCounter = 0;
     uint8_t _boardLEDs[2];
-    uint8_t _regs[3] = {IVRA, IVRB, ACR};
     uint8_t _tapPointer[2];
-    uint8_t _initialState[3]; // Holds the initial values from Registers: IVRA([0]), IVRB([1]) and ACR([2]).
+    uint8_t _acr;     // Shadow of the ACR, seeded by begin()
+    uint8_t _cacheValid = 0;    // TPL0102_CACHE_A / _B / _ACR
+    bool _verifyPending = false;  // beginFast(..., lazyVerify): check the restored state on first use
+    uint8_t _nvRestoreACR = TPL0102_NV_IDLE;    // ACR to restore once a save completes
     uint8_t _selectedChannel;
     unsigned long _incDelay;
     unsigned long _decDelay;
     unsigned long _setDelay;
     bool _debug;
     bool _ledsDefined;
-    uint8_t _prevLEDsState[2];
-    float _nominalResistance;
+    uint8_t _ledShown = TPL0102_LED_UNSET;    // Channel the LEDs show
+    bool _ledsDeferred = false;
+    uint32_t _nominalOhms;
+    const TPL0102Calibration *_calibration[2] = {NULL, NULL};
+
+    struct asyncWrite{
+      uint8_t ch;
+      uint8_t val;
+    };
+    asyncWrite _asyncQueue[TPL0102_ASYNC_QUEUE_SIZE];
+    volatile uint8_t _asyncHead = 0;
+    volatile uint8_t _asyncTail = 0;
+    AsyncCallback _asyncCallback = NULL;
+
+    bool _coalescing = false;
+    uint8_t _pendingMask = 0;     // bit 0: POT A, bit 1: POT B (coalesced), TPL0102_SLEW_A / _B
+    uint8_t _slewStep = 1;
+    uint8_t _pendingTap[2];
+    unsigned long _flushInterval = 0;
+    unsigned long _lastFlush = 0;
+    unsigned long _slewInterval = 0;    // Own timebase: a coalescing flush never moves it
+    unsigned long _lastSlew = 0;
+#if TPL0102_LOCKING
+    TaskHandle_t _asyncTask = NULL;
+    static void asyncTaskLoop(void *arg);
+#endif
    
     void readRegistersStatus(void);
     void readDummyRegStatus(void);
+    uint8_t writeACR(uint8_t val);
+    bool redundant(uint8_t mask, uint8_t cached, uint8_t val);
+    void initBus(void);
+    void setupBus(TPL0102Transport &transport, uint16_t addr, float nomRes, uint32_t speed, int sda, int scl);
+    uint8_t startNonVolatile(uint8_t reg, const uint8_t *vals, uint8_t len);
+    uint8_t waitNonVolatile(void);
+    bool verifyDue(void);
+    uint8_t verifyWipers(uint8_t ch, uint8_t len, const uint8_t *expected);
+#if TPL0102_STATS
+    TPL0102Stats _stats;
+    void recordLatency(uint8_t op, unsigned long us);
+    void recordResult(uint8_t res);
+#endif
+#if TPL0102_DEBUG >= 2
+    static TraceEntry _trace[TPL0102_TRACE_DEPTH];
+    static uint8_t _traceHead;
+    static uint8_t _traceCount;
+    void traceEvent(uint8_t op, uint8_t ch, uint8_t val, uint8_t res);
+#endif
+    void setScales(float nomRes);
+    void coalesce(uint8_t ch, uint8_t val);
+    uint8_t slew(void);
+    uint8_t cachedTap(uint8_t ch);
+#if TPL0102_LOCKING
+    std::atomic<uint32_t> _snapshot{0};   // Published by Guard, read by snapshot() without locking
+
+    // Takes the bus mutex for a scope, publishes the snapshot before releasing it
+    class Guard {
+      public:
+        explicit Guard(TPL0102 *pot) : _pot(pot), _lock(pot->_transport->busKey()) {}
+        ~Guard() { _pot->publishSnapshot(); }
+      private:
+        TPL0102 *_pot;
+        TPL0102BusLock _lock;
+    };
+    void publishSnapshot(void);
+#endif
+    uint8_t streamRamp(uint8_t ch, uint8_t from, uint8_t to, uint8_t step, unsigned int stepDelay, bool stop, uint8_t &lastTap);
 
     void toggleLED(uint8_t);
+    static void ledWrite(uint8_t pin, uint8_t level);
 
 };
 
+#if defined(__AVR__) && !TPL0102_STATS
+static_assert(sizeof(TPL0102) <= 80, "TPL0102 outgrew its AVR footprint target");
+#endif
+
 #endif
@@ -0,0 +1,265 @@
+/*
+    TPL0102Bus: manager for up to eight TPL0102 sharing one I2C bus
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Bus.h"
+
+
+// Constructor
+
+TPL0102Bus::TPL0102Bus() {
+
+  _presentMask = 0;
+
+}
+
+// Methods
+
+// Owns the bus: called once for all the devices. Returns how many pots answered
+uint8_t TPL0102Bus::begin(uint32_t speed) {
+
+  return begin(Wire, speed, SDA, SCL);
+
+}
+
+// Any TwoWire bus (e.g. Wire1 on the ESP32). Pins < 0 keep the default pins of that bus
+uint8_t TPL0102Bus::begin(TwoWire &wirePort, uint32_t speed, int sda, int scl) {
+
+  _wire = &wirePort;
+
+#if defined(ESP32)
+  if ((sda >= 0) && (scl >= 0))
+    _wire->begin(sda, scl);
+  else
+    _wire->begin();
+#else
+  (void)sda;
+  (void)scl;
+  _wire->begin();     // Fixed pins on the other cores
+#endif
+
+  I2CSpeed = speed;
+  _wire->setClock(I2CSpeed);
+
+#if TPL0102_LOCKING
+  TPL0102BusLock::forBus(_wire);    // Shared with the TPL0102 drivers on this bus
+#endif
+
+  return discover();
+
+}
+
+// Probe every possible address and seed the state table from the ones present
+uint8_t TPL0102Bus::discover() {
+
+  TPL0102_BUS_LOCK(_wire);
+
+  _presentMask = 0;
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    _wire->beginTransmission(deviceAddress(dev));
+
+    if (_wire->endTransmission(true) != 0)
+      continue;
+
+    _presentMask |= (1 << dev);
+
+    // Factory values are kept for whatever cannot be read, as TPL0102::readRegistersStatus() does
+    uint8_t state[3] = {(uint8_t)FACTORY_WIPER_POSITION, (uint8_t)FACTORY_WIPER_POSITION, SHUTDOWN_MASK};
+
+    if (readRegisters(dev, IVRA, state, 2) != 2) {     // IVRA + IVRB in one burst
+      state[0] = (uint8_t)FACTORY_WIPER_POSITION;
+      state[1] = (uint8_t)FACTORY_WIPER_POSITION;
+    }
+
+    if (readRegisters(dev, ACR, &state[2], 1) != 1)
+      state[2] = SHUTDOWN_MASK;
+
+    _taps[dev][0] = state[0];
+    _taps[dev][1] = state[1];
+    _acr[dev] = state[2] & ~WIP_MASK;
+  }
+
+  return count();
+
+}
+
+// Number of devices found by discover()
+uint8_t TPL0102Bus::count() {
+
+  uint8_t n = 0;
+
+  for (uint8_t mask = _presentMask; mask; mask >>= 1)
+    n += mask & 0x01;
+
+  return n;
+
+}
+
+bool TPL0102Bus::present(uint8_t dev) {
+
+  return (dev < TPL0102_BUS_MAX_DEVICES) && (_presentMask & (1 << dev));
+
+}
+
+// dev is the A2A1A0 strap value [0-7]
+uint8_t TPL0102Bus::deviceAddress(uint8_t dev) {
+
+  return TPL0102_BUS_BASE_ADDRESS + dev;
+
+}
+
+// Out of range devices read as 0 (dev and ch often come from a host, see TPL0102Link)
+uint8_t TPL0102Bus::taps(uint8_t dev, uint8_t ch) {
+
+  if (dev >= TPL0102_BUS_MAX_DEVICES)
+    return 0;
+
+  return _taps[dev][ch & 0x01];
+
+}
+
+uint8_t TPL0102Bus::acr(uint8_t dev) {
+
+  if (dev >= TPL0102_BUS_MAX_DEVICES)
+    return 0;
+
+  return _acr[dev];
+
+}
+
+// Single channel update. Returns the I2C result (0: OK)
+uint8_t TPL0102Bus::setTap(uint8_t dev, uint8_t ch, uint8_t val) {
+
+  TPL0102_BUS_LOCK(_wire);
+
+  if (!present(dev))
+    return 2;     // Same code Wire uses for an address NACK (dev past the last one too)
+
+  ch &= 0x01;
+
+  if (_taps[dev][ch] == val)
+    return 0;
+
+  _wire->beginTransmission(deviceAddress(dev));
+  _wire->write((ch == CHB) ? WRB : WRA);
+  _wire->write(val);
+  uint8_t res = _wire->endTransmission(true);
+
+  if (res == 0)
+    _taps[dev][ch] = val;
+
+  return res;
+
+}
+
+// Both channels of one device in a single dual-register transaction
+uint8_t TPL0102Bus::setTaps(uint8_t dev, uint8_t valA, uint8_t valB) {
+
+  if (!present(dev))
+    return 2;
+
+  if ((_taps[dev][0] == valA) && (_taps[dev][1] == valB))
+    return 0;
+
+  return writeDevice(dev, valA, valB, true);
+
+}
+
+// Batched update of every present device: taps[dev][chan], indexed by the A2A1A0 value.
+// Only the devices that changed are addressed, back-to-back with repeated START. Cores without
+// real repeated START (TPL0102_WIRE_REPEATED_START 0, arduino-esp32) get one STOP per device:
+// a chained write would be dropped there. Returns the first I2C error found (0: OK)
+uint8_t TPL0102Bus::applyAll(const uint8_t taps[][2]) {
+
+  TPL0102_BUS_LOCK(_wire);    // The whole batch, up to the final STOP
+
+  uint8_t pending = 0;
+  uint8_t res = 0;
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    if (present(dev) && ((_taps[dev][0] != taps[dev][0]) || (_taps[dev][1] != taps[dev][1])))
+      pending |= (1 << dev);
+  }
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    if (!(pending & (1 << dev)))
+      continue;
+
+    pending &= ~(1 << dev);
+
+    bool stop = (pending == 0) || !TPL0102_WIRE_REPEATED_START;     // STOP only after the last one
+
+    uint8_t devRes = writeDevice(dev, taps[dev][0], taps[dev][1], stop);
+
+    if ((devRes != 0) && (res == 0))
+      res = devRes;
+  }
+
+  return res;
+
+}
+
+// Writes only the registers that differ from the table: WRA, WRB or both (auto-increment)
+uint8_t TPL0102Bus::writeDevice(uint8_t dev, uint8_t valA, uint8_t valB, bool stop) {
+
+  TPL0102_BUS_LOCK(_wire);
+
+  bool writeA = (_taps[dev][0] != valA);
+
+  _wire->beginTransmission(deviceAddress(dev));
+
+  if (writeA) {
+
+    _wire->write(WRA);
+    _wire->write(valA);
+
+    if (_taps[dev][1] != valB)
+      _wire->write(valB);     // WRB (auto-increment)
+
+  } else {
+
+    _wire->write(WRB);
+    _wire->write(valB);
+  }
+
+  uint8_t res = _wire->endTransmission(stop);
+
+  if (res == 0) {
+    _taps[dev][0] = valA;
+    _taps[dev][1] = valB;
+  }
+
+  return res;
+
+}
+
+// Pointer write, repeated START, burst read. Returns the bytes read: 0 if the pointer write failed
+uint8_t TPL0102Bus::readRegisters(uint8_t dev, uint8_t startReg, uint8_t *buf, uint8_t len) {
+
+  TPL0102_BUS_LOCK(_wire);
+
+  uint8_t count = 0;
+
+  _wire->beginTransmission(deviceAddress(dev));
+  _wire->write(startReg);
+
+  if (_wire->endTransmission(false) != 0)
+    return 0;
+
+  _wire->requestFrom(static_cast<uint16_t>(deviceAddress(dev)), static_cast<size_t>(len), static_cast<bool>(true));
+
+  while (_wire->available() && (count < len))
+  {
+    buf[count++] = (uint8_t)_wire->read();
+  }
+
+  return count;
+
+}
@@ -0,0 +1,54 @@
+/*
+    TPL0102Bus: manager for up to eight TPL0102 sharing one I2C bus
+    Author: Daniel Melendrez
+    The bus is set up once, the devices answering at 0x50-0x57 (A2A1A0) are discovered
+    and a compact table keeps the wipers and ACR of all of them.
+    Batched updates run back-to-back with repeated START and a single final STOP
+    (one STOP per device on cores without real repeated START, see TPL0102_WIRE_REPEATED_START).
+    License: MIT
+
+*/
+
+#ifndef TPL0102Bus_h
+#define TPL0102Bus_h
+
+#include "TPL0102.h"
+
+#define TPL0102_BUS_BASE_ADDRESS 0x50   // A2A1A0 = 000
+#define TPL0102_BUS_MAX_DEVICES 8
+
+class TPL0102Bus {
+
+  public:
+
+    // Constructor:
+    TPL0102Bus(void);
+
+    uint32_t I2CSpeed = STANDARD;
+
+    // Methods:
+    uint8_t begin(uint32_t speed);
+    uint8_t begin(TwoWire &wirePort, uint32_t speed, int sda = -1, int scl = -1);
+    uint8_t discover(void);
+    uint8_t count(void);
+    bool present(uint8_t dev);
+    uint8_t deviceAddress(uint8_t dev);
+    uint8_t taps(uint8_t dev, uint8_t chan);
+    uint8_t acr(uint8_t dev);
+    uint8_t setTap(uint8_t dev, uint8_t chan, uint8_t val);
+    uint8_t setTaps(uint8_t dev, uint8_t valA, uint8_t valB);
+    uint8_t applyAll(const uint8_t taps[][2]);
+
+  private:
+
+    TwoWire *_wire = &Wire;
+    uint8_t _presentMask;     // bit n: device at TPL0102_BUS_BASE_ADDRESS + n answered
+    uint8_t _taps[TPL0102_BUS_MAX_DEVICES][2];
+    uint8_t _acr[TPL0102_BUS_MAX_DEVICES];
+
+    uint8_t writeDevice(uint8_t dev, uint8_t valA, uint8_t valB, bool stop);
+    uint8_t readRegisters(uint8_t dev, uint8_t startReg, uint8_t *buf, uint8_t len);
+
+};
+
+#endif
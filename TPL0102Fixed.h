@@ -0,0 +1,133 @@
+/*
+    TPL0102Fixed: header-only driver for one wiper whose address and channel are known at compile time
+    Author: Daniel Melendrez
+    Address, wiper register and channel are template arguments, so there is no switch, no channel
+    index and no range check left at run time: every write inlines to beginTransmission, two bytes
+    and endTransmission. Several wipers (or both channels of one chip) are just several objects.
+
+      TPL0102Fixed<0x50, CHA> potA;
+      TPL0102Fixed<0x50, CHB> potB;
+
+    Use TPL0102 for everything else (ACR, non-volatile, calibration, async...).
+    License: MIT
+
+*/
+
+#ifndef TPL0102Fixed_h
+#define TPL0102Fixed_h
+
+#include "TPL0102.h"
+
+template <uint8_t Addr, uint8_t Channel>
+class TPL0102Fixed {
+
+  static_assert((Addr >= 0x50) && (Addr <= 0x57), "TPL0102 answers at 0x50-0x57 (A2A1A0)");
+  static_assert((Channel == CHA) || (Channel == CHB), "Channel must be CHA or CHB");
+
+  public:
+
+    static constexpr uint8_t address = Addr;
+    static constexpr uint8_t channel = Channel;
+    static constexpr uint8_t wiperRegister = (Channel == CHB) ? WRB : WRA;
+    static constexpr uint8_t maxTap = 255;
+
+    // Constructor:
+    explicit TPL0102Fixed(TwoWire &wirePort = Wire) : _wire(&wirePort) {}
+
+    // Sets the bus up and reads the wiper once. Returns the I2C result (0: OK)
+    uint8_t begin(uint32_t speed = FAST) {
+
+      _wire->begin();
+      _wire->setClock(speed);
+
+      return refresh();
+    }
+
+    // Wiper bus already set up by someone else (TPL0102, TPL0102Bus...)
+    uint8_t attach(void) {
+
+      return refresh();
+    }
+
+    // Re-read the wiper from the chip
+    uint8_t refresh(void) {
+
+      TPL0102_BUS_LOCK(_wire);
+
+      _wire->beginTransmission(Addr);
+      _wire->write(wiperRegister);
+      _lastError = _wire->endTransmission(false);
+
+      if (_lastError == 0) {
+
+        if ((_wire->requestFrom(static_cast<uint16_t>(Addr), static_cast<size_t>(1), static_cast<bool>(true)) == 1)
+            && _wire->available()) {
+          _tap = (uint8_t)_wire->read();
+          _valid = true;
+        } else {
+          _lastError = 4;
+        }
+      }
+
+      return _lastError;
+    }
+
+    // Returns the I2C result. Nothing is sent when the chip already holds the tap
+    inline uint8_t setTap(uint8_t tap) {
+
+      if (_valid && (tap == _tap))
+        return 0;
+
+      TPL0102_BUS_LOCK(_wire);
+
+      _wire->beginTransmission(Addr);
+      _wire->write(wiperRegister);
+      _wire->write(tap);
+      _lastError = _wire->endTransmission(true);
+
+      _valid = (_lastError == 0);
+
+      if (_valid)
+        _tap = tap;
+
+      return _lastError;
+    }
+
+    inline uint8_t inc(void) { return (_tap < maxTap) ? setTap(_tap + 1) : 0; }
+    inline uint8_t dec(void) { return (_tap > 0) ? setTap(_tap - 1) : 0; }
+    inline uint8_t zeroWiper(void) { return setTap(0); }
+    inline uint8_t maxWiper(void) { return setTap(maxTap); }
+
+    // Nominal scale, a compile-time divisor (exact rounding, see TPL0102::ohmsToTap())
+    inline uint8_t setOhms(uint32_t ohms) { return setTap(ohmsToTap(ohms)); }
+    inline uint32_t readOhms(void) const { return tapToOhms(_tap); }
+
+    static inline uint8_t ohmsToTap(uint32_t ohms) {
+
+      return (ohms >= TPL0102_NOMINAL_RESISTANCE) ? maxTap
+        : (uint8_t)((ohms * 255UL + TPL0102_NOMINAL_RESISTANCE / 2) / TPL0102_NOMINAL_RESISTANCE);
+    }
+
+    static inline uint32_t tapToOhms(uint8_t tap) {
+
+      return ((uint32_t)tap * TPL0102_NOMINAL_RESISTANCE + 127) / 255;
+    }
+
+    inline uint8_t taps(void) const { return _tap; }
+    inline uint8_t lastError(void) const { return _lastError; }
+
+  private:
+
+    TwoWire *_wire;
+    uint8_t _tap = 0;
+    uint8_t _lastError = 0;
+    bool _valid = false;      // _tap matches the chip
+
+};
+
+template <uint8_t Addr, uint8_t Channel> constexpr uint8_t TPL0102Fixed<Addr, Channel>::address;
+template <uint8_t Addr, uint8_t Channel> constexpr uint8_t TPL0102Fixed<Addr, Channel>::channel;
+template <uint8_t Addr, uint8_t Channel> constexpr uint8_t TPL0102Fixed<Addr, Channel>::wiperRegister;
+template <uint8_t Addr, uint8_t Channel> constexpr uint8_t TPL0102Fixed<Addr, Channel>::maxTap;
+
+#endif
@@ -0,0 +1,125 @@
+/*
+    TPL0102Gang: both channels of a TPL0102 driven as one logical control
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Gang.h"
+
+
+// Constructor
+
+TPL0102Gang::TPL0102Gang(TPL0102 &pot, uint8_t mode) {
+
+  _pot = &pot;
+  _mode = mode;
+
+}
+
+void TPL0102Gang::setMode(uint8_t mode) {
+
+  _mode = mode;
+
+}
+
+uint8_t TPL0102Gang::mode() {
+
+  return _mode;
+
+}
+
+uint16_t TPL0102Gang::steps() {
+
+  return (_mode == TPL0102_GANG_SERIES) ? TPL0102_GANG_SERIES_STEPS : TPL0102_GANG_MATCHED_STEPS;
+
+}
+
+// Both wipers in one transaction. Returns the I2C result (0: OK)
+uint8_t TPL0102Gang::setStep(uint16_t step) {
+
+  if (step >= steps())
+    step = steps() - 1;
+
+  if (_mode == TPL0102_GANG_SERIES)
+    return _pot->setTaps((step + 1) / 2, step / 2);     // A leads B by one tap on odd steps
+
+  return _pot->setTaps(step, matchB(step));
+
+}
+
+// Position as a fraction of the whole control [0-1]
+uint8_t TPL0102Gang::setRatio(float ratio) {
+
+  if (ratio <= 0)
+    return setStep(0);
+
+  if (ratio >= 1)
+    return setStep(steps() - 1);
+
+  return setStep((uint16_t)(ratio * (steps() - 1) + 0.5));
+
+}
+
+// SERIES: total resistance of A + B. MATCHED: resistance of each channel.
+// Uses the calibration tables when the pot has them
+uint8_t TPL0102Gang::setOhms(uint32_t ohms) {
+
+  if (_mode != TPL0102_GANG_SERIES)
+    return _pot->setTaps(_pot->ohmsToTap(CHA, ohms), _pot->ohmsToTap(CHB, ohms));
+
+  // Split the target evenly, then let B absorb what A's rounding left over.
+  // A one step either side covers the uneven segments of calibrated channels
+  uint8_t center = _pot->ohmsToTap(CHA, ohms / 2);
+  uint8_t bestA = center;
+  uint8_t bestB = 0;
+  uint32_t bestError = 0xFFFFFFFF;
+
+  for (int8_t offset = -1; offset <= 1; offset++) {
+
+    int tapA = center + offset;
+
+    if ((tapA < 0) || (tapA > TPL0102_TAP_NUMBER))
+      continue;
+
+    uint32_t ohmsA = _pot->tapToOhms(CHA, tapA);
+    uint8_t tapB = (ohmsA < ohms) ? _pot->ohmsToTap(CHB, ohms - ohmsA) : 0;
+    uint32_t total = ohmsA + _pot->tapToOhms(CHB, tapB);
+    uint32_t error = (total > ohms) ? (total - ohms) : (ohms - total);
+
+    if (error < bestError) {
+      bestError = error;
+      bestA = tapA;
+      bestB = tapB;
+    }
+  }
+
+  return _pot->setTaps(bestA, bestB);
+
+}
+
+// Current step, from the cached wipers
+uint16_t TPL0102Gang::step() {
+
+  if (_mode == TPL0102_GANG_SERIES)
+    return _pot->taps(CHA) + _pot->taps(CHB);
+
+  return _pot->taps(CHA);
+
+}
+
+uint32_t TPL0102Gang::readOhms() {
+
+  if (_mode == TPL0102_GANG_SERIES)
+    return _pot->readOhms(CHA) + _pot->readOhms(CHB);
+
+  return _pot->readOhms(CHA);
+
+}
+
+// POT B tap with the resistance closest to POT A at tapA (the same tap without calibration)
+uint8_t TPL0102Gang::matchB(uint8_t tapA) {
+
+  return _pot->ohmsToTap(CHB, _pot->tapToOhms(CHA, tapA));
+
+}
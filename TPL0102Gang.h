@@ -0,0 +1,50 @@
+/*
+    TPL0102Gang: both channels of a TPL0102 driven as one logical control
+    Author: Daniel Melendrez
+    SERIES:  POT A and POT B in series, 511 steps (0-510): step n puts (n+1)/2 taps on A and n/2 on B.
+    MATCHED: both wipers track each other (stereo pairs, parallel halves), 256 steps. With
+             calibration tables POT B is set to the tap that best matches the resistance of POT A.
+    Every update is a single dual-register transaction (TPL0102::setTaps).
+    License: MIT
+
+*/
+
+#ifndef TPL0102Gang_h
+#define TPL0102Gang_h
+
+#include "TPL0102.h"
+
+// Modes
+#define TPL0102_GANG_SERIES 0
+#define TPL0102_GANG_MATCHED 1
+
+#define TPL0102_GANG_SERIES_STEPS 511
+#define TPL0102_GANG_MATCHED_STEPS 256
+
+class TPL0102Gang {
+
+  public:
+
+    // Constructor:
+    TPL0102Gang(TPL0102 &pot, uint8_t mode = TPL0102_GANG_SERIES);
+
+    // Methods:
+    void setMode(uint8_t mode);
+    uint8_t mode(void);
+    uint16_t steps(void);
+    uint8_t setStep(uint16_t step);
+    uint8_t setRatio(float ratio);
+    uint8_t setOhms(uint32_t ohms);
+    uint16_t step(void);
+    uint32_t readOhms(void);
+
+  private:
+
+    TPL0102 *_pot;
+    uint8_t _mode;
+
+    uint8_t matchB(uint8_t tapA);
+
+};
+
+#endif
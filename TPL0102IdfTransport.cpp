@@ -0,0 +1,250 @@
+/*
+    TPL0102IdfTransport: ESP-IDF I2C driver backend for TPL0102 (ESP32 only, opt-in)
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102IdfTransport.h"
+
+#if TPL0102_IDF_TRANSPORT && defined(ESP32)
+
+// Constructor
+
+TPL0102IdfTransport::TPL0102IdfTransport(i2c_port_t port) {
+
+  _port = port;
+  memset(&_config, 0, sizeof(_config));
+  _installed = false;
+  _chain = NULL;
+  _jobs = NULL;
+  _worker = NULL;
+
+}
+
+void TPL0102IdfTransport::begin(uint32_t speed, int sda, int scl) {
+
+  if (_installed)
+    end();      // recoverBus(): install again on the released pins
+
+  _config.mode = I2C_MODE_MASTER;
+  _config.sda_io_num = (sda >= 0) ? sda : SDA;
+  _config.scl_io_num = (scl >= 0) ? scl : SCL;
+  _config.sda_pullup_en = GPIO_PULLUP_ENABLE;
+  _config.scl_pullup_en = GPIO_PULLUP_ENABLE;
+  _config.master.clk_speed = speed;
+
+  i2c_param_config(_port, &_config);
+  _installed = (i2c_driver_install(_port, I2C_MODE_MASTER, 0, 0, 0) == ESP_OK);
+
+  if (_jobs == NULL) {
+
+    _jobs = xQueueCreate(TPL0102_IDF_QUEUE_DEPTH, sizeof(job));
+
+    if (_jobs != NULL)
+      xTaskCreate(workerLoop, "TPL0102_i2c", TPL0102_IDF_TASK_STACK, this, TPL0102_IDF_TASK_PRIORITY, &_worker);
+  }
+
+}
+
+// Releases the pins. An open chain is dropped, queued jobs fail until begin() again
+void TPL0102IdfTransport::end() {
+
+  if (_chain != NULL) {
+    i2c_cmd_link_delete(_chain);
+    _chain = NULL;
+  }
+
+  if (_installed)
+    i2c_driver_delete(_port);
+
+  _installed = false;
+
+}
+
+void TPL0102IdfTransport::setClock(uint32_t speed) {
+
+  _config.master.clk_speed = speed;
+
+  if (_installed)
+    i2c_param_config(_port, &_config);
+
+}
+
+// stop = false: queued in the chain and 0 is returned, nothing is on the bus yet (TPL0102_CHAIN_DEFERRED).
+// The chain goes out with the next STOP, which returns the result of all of it
+uint8_t TPL0102IdfTransport::write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, bool stop) {
+
+  i2c_cmd_handle_t cmd = chain();
+
+  if (cmd == NULL)
+    return 4;
+
+  appendWrite(cmd, addr, reg, data, len);
+
+  if (!stop)
+    return 0;
+
+  i2c_master_stop(cmd);
+  _chain = NULL;
+
+  return run(cmd);
+
+}
+
+// Pointer write, repeated START and burst read in one job, after any open chain
+uint8_t TPL0102IdfTransport::read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, uint8_t &count) {
+
+  count = 0;
+
+  i2c_cmd_handle_t cmd = chain();
+
+  if (cmd == NULL)
+    return 4;
+
+  appendWrite(cmd, addr, reg, NULL, 0);
+  i2c_master_start(cmd);
+  i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
+
+  if (len)
+    i2c_master_read(cmd, buf, len, I2C_MASTER_LAST_NACK);
+
+  i2c_master_stop(cmd);
+  _chain = NULL;
+
+  uint8_t res = run(cmd);
+
+  if (res == 0)
+    count = len;
+
+  return res;
+
+}
+
+// Copies the data and returns at once; cb gets the result from the worker task.
+// false: queue full or too much data (see TPL0102_IDF_ASYNC_MAX_DATA)
+bool TPL0102IdfTransport::writeAsync(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, TPL0102TransportCallback cb, void *context) {
+
+  if ((_jobs == NULL) || (len > TPL0102_IDF_ASYNC_MAX_DATA))
+    return false;
+
+  job j;
+
+  j.cmd = NULL;
+  j.cb = cb;
+  j.context = context;
+  j.addr = addr;
+  j.reg = reg;
+  j.len = len;
+  memcpy(j.data, data, len);
+
+  return xQueueSend(_jobs, &j, 0) == pdTRUE;
+
+}
+
+// Any finished command link (STOP included), e.g. one appendWrite() per device of a batch.
+// On true the transport owns cmd and deletes it after the job; on false it stays with the caller
+bool TPL0102IdfTransport::submit(i2c_cmd_handle_t cmd, TPL0102TransportCallback cb, void *context) {
+
+  if ((_jobs == NULL) || (cmd == NULL))
+    return false;
+
+  job j;
+
+  j.cmd = cmd;
+  j.cb = cb;
+  j.context = context;
+  j.len = 0;
+
+  return xQueueSend(_jobs, &j, 0) == pdTRUE;
+
+}
+
+// Jobs waiting for the worker (the one on the bus not included)
+uint8_t TPL0102IdfTransport::asyncPending() {
+
+  return (_jobs != NULL) ? uxQueueMessagesWaiting(_jobs) : 0;
+
+}
+
+// START, address, register pointer, data. Byte by byte: the link keeps a copy, not the
+// caller's pointer (chained steps reuse the same buffer)
+void TPL0102IdfTransport::appendWrite(i2c_cmd_handle_t cmd, uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len) {
+
+  i2c_master_start(cmd);
+  i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_write_byte(cmd, reg, true);
+
+  for (uint8_t i = 0; i < len; i++)
+    i2c_master_write_byte(cmd, data[i], true);
+
+}
+
+// Driver errors as Wire status codes. A NACK is reported as 2: the driver does not say which byte
+uint8_t TPL0102IdfTransport::status(esp_err_t err) {
+
+  switch (err) {
+
+    case ESP_OK:
+      return 0;
+
+    case ESP_FAIL:
+      return 2;
+
+    case ESP_ERR_TIMEOUT:
+      return 5;
+
+    default:
+      return 4;
+  }
+}
+
+uint8_t TPL0102IdfTransport::run(i2c_cmd_handle_t cmd) {
+
+  esp_err_t err = i2c_master_cmd_begin(_port, cmd, pdMS_TO_TICKS(TPL0102_IDF_TIMEOUT_MS));
+
+  i2c_cmd_link_delete(cmd);
+
+  return status(err);
+
+}
+
+i2c_cmd_handle_t TPL0102IdfTransport::chain() {
+
+  if (_chain == NULL)
+    _chain = i2c_cmd_link_create();
+
+  return _chain;
+
+}
+
+void TPL0102IdfTransport::workerLoop(void *arg) {
+
+  TPL0102IdfTransport *transport = static_cast<TPL0102IdfTransport *>(arg);
+  job j;
+
+  while (true) {
+
+    if (xQueueReceive(transport->_jobs, &j, portMAX_DELAY) != pdTRUE)
+      continue;
+
+    i2c_cmd_handle_t cmd = j.cmd;
+
+    if (cmd == NULL) {
+
+      cmd = i2c_cmd_link_create();
+
+      if (cmd != NULL) {
+        appendWrite(cmd, j.addr, j.reg, j.data, j.len);
+        i2c_master_stop(cmd);
+      }
+    }
+
+    uint8_t res = (cmd != NULL) ? transport->run(cmd) : 4;
+
+    if (j.cb != NULL)
+      j.cb(j.context, res);
+  }
+}
+
+#endif
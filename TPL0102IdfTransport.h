@@ -0,0 +1,87 @@
+/*
+    TPL0102IdfTransport: ESP-IDF I2C driver backend for TPL0102 (ESP32 only, opt-in)
+    Author: Daniel Melendrez
+    Builds every transaction as a command link that the driver runs from its ISR; the calling
+    task blocks on the driver semaphore, so the CPU goes to the other tasks during the transfer.
+    - Writes ending in a repeated START (stop = false) are not sent on their own: they are chained
+      into one command link with what follows, and the chain goes out as a single hardware job
+      with the next STOP or read (chaining() is TPL0102_CHAIN_DEFERRED). Their 0 only means
+      queued: errors of a chain are reported by the call that sends it. ramp() and sweep() send
+      up to TPL0102_CHAIN_MAX_STEPS steps per job, one step per job when they have a step delay.
+    - writeAsync() and submit() queue a job to a worker task and return straight away. submit()
+      takes any command link (e.g. writes to several devices with appendWrite()), the callback
+      runs in the worker task once the hardware is done. The TPL0102 driver itself stays
+      synchronous on this transport too: setTapAsync() / poll() do not go through writeAsync().
+    Enable with -DTPL0102_IDF_TRANSPORT=1. It uses the legacy driver (driver/i2c.h): give it a
+    port Wire does not use, and note that on arduino-esp32 3.x it cannot share a firmware with Wire.
+    License: MIT
+
+*/
+
+#ifndef TPL0102IdfTransport_h
+#define TPL0102IdfTransport_h
+
+#include "TPL0102Transport.h"
+
+#ifndef TPL0102_IDF_TRANSPORT
+#define TPL0102_IDF_TRANSPORT 0
+#endif
+
+#if TPL0102_IDF_TRANSPORT && defined(ESP32)
+
+#include <driver/i2c.h>
+
+#define TPL0102_IDF_TIMEOUT_MS 50       // Per hardware job (driver timeout -> status 5)
+#define TPL0102_IDF_QUEUE_DEPTH 4       // writeAsync() / submit() jobs waiting for the worker
+#define TPL0102_IDF_ASYNC_MAX_DATA 4    // Bytes after the register pointer in one writeAsync()
+#define TPL0102_IDF_TASK_STACK 2048
+#define TPL0102_IDF_TASK_PRIORITY 2
+
+class TPL0102IdfTransport : public TPL0102Transport {
+
+  public:
+
+    // Constructor:
+    explicit TPL0102IdfTransport(i2c_port_t port = I2C_NUM_1);
+
+    // Methods:
+    void begin(uint32_t speed, int sda, int scl);
+    void end(void);
+    void setClock(uint32_t speed);
+    uint8_t write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, bool stop);
+    uint8_t read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, uint8_t &count);
+    bool writeAsync(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, TPL0102TransportCallback cb, void *context);
+    uint8_t chaining(void) { return TPL0102_CHAIN_DEFERRED; }
+    bool submit(i2c_cmd_handle_t cmd, TPL0102TransportCallback cb, void *context);
+    uint8_t asyncPending(void);
+    static void appendWrite(i2c_cmd_handle_t cmd, uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len);
+    static uint8_t status(esp_err_t err);
+
+  private:
+
+    struct job{
+      i2c_cmd_handle_t cmd;     // NULL: build it from the fields below
+      TPL0102TransportCallback cb;
+      void *context;
+      uint8_t addr;
+      uint8_t reg;
+      uint8_t len;
+      uint8_t data[TPL0102_IDF_ASYNC_MAX_DATA];
+    };
+
+    i2c_port_t _port;
+    i2c_config_t _config;
+    bool _installed;
+    i2c_cmd_handle_t _chain;      // Open repeated-START chain, sent with the next STOP
+    QueueHandle_t _jobs;
+    TaskHandle_t _worker;
+
+    uint8_t run(i2c_cmd_handle_t cmd);
+    i2c_cmd_handle_t chain(void);
+    static void workerLoop(void *arg);
+
+};
+
+#endif
+
+#endif
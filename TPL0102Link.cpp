@@ -0,0 +1,265 @@
+/*
+    TPL0102Link: binary framed command protocol over a Stream for the pots on a TPL0102Bus
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Link.h"
+
+// Parser states
+#define LINK_WAIT_SYNC 0
+#define LINK_CMD 1
+#define LINK_SEQ 2
+#define LINK_COUNT 3
+#define LINK_PAYLOAD 4
+#define LINK_SUM 5
+#define LINK_DISCARD 6      // Oversized frame: its payload and sum are skipped, a 0xA5 in there is data
+
+
+// Constructor
+
+TPL0102Link::TPL0102Link(TPL0102Bus &bus, Stream &port) {
+
+  _bus = &bus;
+  _port = &port;
+  _state = LINK_WAIT_SYNC;
+  _lastByte = 0;
+  resetCounters();
+
+}
+
+// Parses whatever the stream has buffered and runs every complete frame.
+// Returns the number of frames applied
+uint8_t TPL0102Link::service() {
+
+  uint8_t handled = 0;
+
+  while (_port->available() > 0) {
+
+    int c = _port->read();
+
+    if (c < 0)
+      break;
+
+    _lastByte = millis();
+
+    if (feed((uint8_t)c))
+      handled++;
+  }
+
+  if ((_state != LINK_WAIT_SYNC) && (millis() - _lastByte > TPL0102_LINK_TIMEOUT_MS)) {
+
+    if (_state != LINK_DISCARD)
+      _badFrames++;               // An oversized frame was counted already
+
+    _state = LINK_WAIT_SYNC;      // Truncated frame: no reply, the host times out and resends
+  }
+
+  return handled;
+
+}
+
+// Frames executed (SET / GET), whatever their status
+unsigned long TPL0102Link::frames() {
+
+  return _frames;
+
+}
+
+// Frames dropped: bad sum, malformed or truncated
+unsigned long TPL0102Link::badFrames() {
+
+  return _badFrames;
+
+}
+
+void TPL0102Link::resetCounters() {
+
+  _frames = 0;
+  _badFrames = 0;
+
+}
+
+// One byte into the state machine. true once a valid frame was executed
+bool TPL0102Link::feed(uint8_t c) {
+
+  switch (_state) {
+
+    case LINK_WAIT_SYNC:
+
+      if (c == TPL0102_LINK_SYNC)
+        _state = LINK_CMD;
+
+      return false;
+
+    case LINK_CMD:
+
+      _cmd = c;
+      _sum = c;
+      _state = LINK_SEQ;
+
+      return false;
+
+    case LINK_SEQ:
+
+      _seq = c;
+      _sum += c;
+      _state = LINK_COUNT;
+
+      return false;
+
+    case LINK_COUNT:
+
+      _count = c;
+      _sum += c;
+      _index = 0;
+
+      if (_count > TPL0102_LINK_MAX_UPDATES) {
+
+        _state = LINK_DISCARD;
+        _discard = _count * 2 + 1;      // Payload + sum
+        _badFrames++;
+        reply(TPL0102_LINK_BAD_FRAME, NULL, 0);
+
+        return false;
+      }
+
+      _state = _count ? LINK_PAYLOAD : LINK_SUM;
+
+      return false;
+
+    case LINK_PAYLOAD:
+
+      _payload[_index++] = c;
+      _sum += c;
+
+      if (_index == (uint8_t)(_count * 2))
+        _state = LINK_SUM;
+
+      return false;
+
+    case LINK_DISCARD:
+
+      if (--_discard == 0)
+        _state = LINK_WAIT_SYNC;
+
+      return false;
+
+    default:      // LINK_SUM
+
+      _state = LINK_WAIT_SYNC;
+
+      if (c != _sum) {
+
+        _badFrames++;
+        reply(TPL0102_LINK_BAD_SUM, NULL, 0);
+
+        return false;
+      }
+
+      execute();
+
+      return true;
+  }
+}
+
+void TPL0102Link::execute() {
+
+  switch (_cmd) {
+
+    case TPL0102_LINK_SET:
+
+      _frames++;
+      reply(applyUpdates(), NULL, 0);
+
+      break;
+
+    case TPL0102_LINK_GET: {
+
+      uint8_t data[1 + TPL0102_LINK_MAX_UPDATES];
+
+      data[0] = 0;
+
+      for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+        if (_bus->present(dev))
+          data[0] |= (1 << dev);
+
+        data[1 + dev * 2] = _bus->taps(dev, CHA);
+        data[2 + dev * 2] = _bus->taps(dev, CHB);
+      }
+
+      _frames++;
+      reply(0, data, sizeof(data));
+
+      break;
+    }
+
+    default:
+
+      _badFrames++;
+      reply(TPL0102_LINK_BAD_FRAME, NULL, 0);
+  }
+}
+
+// The whole frame as one target table: a single applyAll() batch, one session for all the
+// devices that change. Later updates of the same channel win. A target past the last device
+// rejects the whole frame before anything is sent. Returns the first error
+uint8_t TPL0102Link::applyUpdates() {
+
+  uint8_t taps[TPL0102_BUS_MAX_DEVICES][2];
+  uint8_t status = 0;
+
+  for (uint8_t i = 0; i < _count; i++) {
+
+    if (_payload[i * 2] >= TPL0102_LINK_MAX_UPDATES)
+      return TPL0102_LINK_BAD_FRAME;
+  }
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    taps[dev][0] = _bus->taps(dev, CHA);
+    taps[dev][1] = _bus->taps(dev, CHB);
+  }
+
+  for (uint8_t i = 0; i < _count; i++) {
+
+    uint8_t target = _payload[i * 2];
+
+    if (!_bus->present(target >> 1) && (status == 0))
+      status = 2;     // Same as TPL0102Bus::setTap(): nobody at that address
+
+    taps[target >> 1][target & 0x01] = _payload[i * 2 + 1];
+  }
+
+  uint8_t res = _bus->applyAll(taps);
+
+  return status ? status : res;
+
+}
+
+// Built in one buffer and handed to the stream in a single write
+void TPL0102Link::reply(uint8_t status, const uint8_t *data, uint8_t len) {
+
+  uint8_t frame[5 + 1 + TPL0102_LINK_MAX_UPDATES];
+  uint8_t n = 0;
+
+  frame[n++] = TPL0102_LINK_REPLY_SYNC;
+  frame[n++] = _cmd;
+  frame[n++] = _seq;
+  frame[n++] = status;
+
+  for (uint8_t i = 0; i < len; i++)
+    frame[n++] = data[i];
+
+  uint8_t sum = 0;
+
+  for (uint8_t i = 1; i < n; i++)
+    sum += frame[i];
+
+  frame[n++] = sum;
+
+  _port->write(frame, n);
+
+}
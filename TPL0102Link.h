@@ -0,0 +1,70 @@
+/*
+    TPL0102Link: binary framed command protocol over a Stream (Serial, USB CDC, TCP...) for the pots on a TPL0102Bus
+    Author: Daniel Melendrez
+    Host -> device:   0xA5  cmd  seq  count  count x [target tap]  sum
+                      target = device (A2A1A0) << 1 | channel, sum = (cmd + seq + count + payload) & 0xFF
+    Device -> host:   0x5A  cmd  seq  status  [data]  sum       (one per frame, same sum rule)
+    SET (0x01): up to TPL0102_LINK_MAX_UPDATES updates, applied together as one TPL0102Bus::applyAll()
+                batch once the whole frame has arrived. status: first I2C error (2: device not on the bus)
+    GET (0x02): count 0. data: present mask (bit n: device n) then the 16 wipers, device by device
+    Frames with a bad sum, an unknown command, too many updates or a target past the last device
+    are answered with the TPL0102_LINK_* status and not applied (an oversized frame is skipped
+    whole before the next sync). service() never blocks, call it from loop().
+    License: MIT
+
+*/
+
+#ifndef TPL0102Link_h
+#define TPL0102Link_h
+
+#include "TPL0102Bus.h"
+
+#define TPL0102_LINK_SYNC 0xA5
+#define TPL0102_LINK_REPLY_SYNC 0x5A
+#define TPL0102_LINK_SET 0x01
+#define TPL0102_LINK_GET 0x02
+
+#define TPL0102_LINK_MAX_UPDATES (TPL0102_BUS_MAX_DEVICES * 2)    // Every channel once
+#define TPL0102_LINK_TIMEOUT_MS 50      // A frame stalled this long is dropped (resync on the next 0xA5)
+
+// Status of the reply, after the Wire codes
+#define TPL0102_LINK_BAD_SUM 0xE1
+#define TPL0102_LINK_BAD_FRAME 0xE2     // Unknown command, too many updates or a target past the last device
+
+class TPL0102Link {
+
+  public:
+
+    // Constructor:
+    TPL0102Link(TPL0102Bus &bus, Stream &port);
+
+    // Methods:
+    uint8_t service(void);
+    unsigned long frames(void);
+    unsigned long badFrames(void);
+    void resetCounters(void);
+
+  private:
+
+    TPL0102Bus *_bus;
+    Stream *_port;
+    uint8_t _state;
+    uint8_t _cmd;
+    uint8_t _seq;
+    uint8_t _count;
+    uint8_t _index;
+    uint8_t _sum;
+    uint16_t _discard;      // Bytes of an oversized frame still to skip
+    uint8_t _payload[TPL0102_LINK_MAX_UPDATES * 2];
+    unsigned long _lastByte;
+    unsigned long _frames;
+    unsigned long _badFrames;
+
+    bool feed(uint8_t c);
+    void execute(void);
+    uint8_t applyUpdates(void);
+    void reply(uint8_t status, const uint8_t *data, uint8_t len);
+
+};
+
+#endif
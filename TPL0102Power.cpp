@@ -0,0 +1,220 @@
+/*
+    TPL0102Power: duty-cycle scheduler for the shutdown mode of a TPL0102
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Power.h"
+
+
+// Constructor
+
+TPL0102Power::TPL0102Power(TPL0102 &pot) {
+
+  _pot = &pot;
+  _period = 0;
+  _activeWindow = 0;
+  _pendingMask = 0;
+  _running = false;
+  _active = true;     // The chip powers up active
+  resetCounters();
+
+}
+
+// activeMs at the start of every periodMs. activeMs >= periodMs keeps the pot always on,
+// periodMs 0 stops the scheduler (same as stop())
+void TPL0102Power::setSchedule(unsigned long periodMs, unsigned long activeMs) {
+
+  _period = periodMs;
+  _activeWindow = activeMs;
+
+  if ((_period == 0) && _running)
+    stop();
+
+}
+
+// First period starts now (active window first). Returns the I2C result
+uint8_t TPL0102Power::start() {
+
+  unsigned long now = millis();
+
+  account(now);
+
+  _active = (_pot->acr() & SHUTDOWN_MASK) != 0;    // Whatever begin() found in the ACR
+  _periodStart = now;
+  _running = (_period > 0);
+
+  return _active ? 0 : wake();
+
+}
+
+// Back to always on: the held back wipers go out with the wake-up
+uint8_t TPL0102Power::stop() {
+
+  account(millis());
+
+  _running = false;
+
+  return _active ? 0 : wake();
+
+}
+
+// Shuts down / wakes up at the window edges. Cheap when nothing is due: no bus traffic.
+// Returns the I2C result of the transition, 0 otherwise
+uint8_t TPL0102Power::service() {
+
+  if (!_running || (_period == 0))
+    return 0;
+
+  unsigned long now = millis();
+  unsigned long elapsed = now - _periodStart;
+
+  account(now);
+
+  if (elapsed >= _period) {
+
+    _periodStart += _period * (elapsed / _period);    // Skip whole periods if service() was late
+    elapsed = now - _periodStart;
+  }
+
+  bool due = (elapsed < _activeWindow);
+
+  if (due == _active)
+    return 0;
+
+  return due ? wake() : sleep();
+
+}
+
+bool TPL0102Power::active() {
+
+  return _active;
+
+}
+
+// Straight to the chip while active, held back until the next wake-up otherwise
+uint8_t TPL0102Power::setTap(uint8_t ch, uint8_t tap) {
+
+  if (_active) {
+    _pot->setTap(ch, tap);
+    return _pot->lastError();
+  }
+
+  _pendingTap[ch & 0x01] = tap;
+  _pendingMask |= (1 << (ch & 0x01));
+
+  return 0;
+
+}
+
+uint8_t TPL0102Power::setTaps(uint8_t tapA, uint8_t tapB) {
+
+  if (_active)
+    return _pot->setTaps(tapA, tapB);
+
+  _pendingTap[0] = tapA;
+  _pendingTap[1] = tapB;
+  _pendingMask = 0x03;
+
+  return 0;
+
+}
+
+unsigned long TPL0102Power::activeMillis() {
+
+  account(millis());
+
+  return _activeTime;
+
+}
+
+unsigned long TPL0102Power::shutdownMillis() {
+
+  account(millis());
+
+  return _shutdownTime;
+
+}
+
+// Fraction of the time spent active since the last resetCounters() [0-1]
+float TPL0102Power::dutyCycle() {
+
+  account(millis());
+
+  unsigned long total = _activeTime + _shutdownTime;
+
+  return total ? (float)_activeTime / total : 1.0;
+
+}
+
+// Number of shutdown + wake-up ACR writes
+unsigned long TPL0102Power::transitions() {
+
+  return _transitions;
+
+}
+
+void TPL0102Power::resetCounters() {
+
+  _lastAccount = millis();
+  _activeTime = 0;
+  _shutdownTime = 0;
+  _transitions = 0;
+
+}
+
+void TPL0102Power::account(unsigned long now) {
+
+  unsigned long spent = now - _lastAccount;
+
+  if (_active)
+    _activeTime += spent;
+  else
+    _shutdownTime += spent;
+
+  _lastAccount = now;
+
+}
+
+// Wake-up ACR write and the held back wipers in the same session (TPL0102::wakeWithTaps)
+uint8_t TPL0102Power::wake() {
+
+  uint8_t res;
+
+  if (_pendingMask) {
+
+    uint8_t tapA = (_pendingMask & 0x01) ? _pendingTap[0] : _pot->taps(CHA);
+    uint8_t tapB = (_pendingMask & 0x02) ? _pendingTap[1] : _pot->taps(CHB);
+
+    res = _pot->wakeWithTaps(tapA, tapB);
+
+    if (res == 0)
+      _pendingMask = 0;
+
+  } else {
+
+    res = _pot->switchPot(CHA, HIGH);     // SHDN is shared by both channels
+  }
+
+  if (res == 0) {
+    _active = true;
+    _transitions++;
+  }
+
+  return res;
+
+}
+
+uint8_t TPL0102Power::sleep() {
+
+  uint8_t res = _pot->switchPot(CHA, LOW);
+
+  if (res == 0) {
+    _active = false;
+    _transitions++;
+  }
+
+  return res;
+
+}
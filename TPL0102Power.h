@@ -0,0 +1,59 @@
+/*
+    TPL0102Power: duty-cycle scheduler for the shutdown mode of a TPL0102
+    Author: Daniel Melendrez
+    Every period starts with an active window; the rest of the period the pot is shut down
+    (ACR SHDN, both channels). Wiper updates requested while it sleeps are held back and sent
+    together with the wake-up ACR write, in one bus session. service() does the transitions,
+    call it from loop().
+    License: MIT
+
+*/
+
+#ifndef TPL0102Power_h
+#define TPL0102Power_h
+
+#include "TPL0102.h"
+
+class TPL0102Power {
+
+  public:
+
+    // Constructor:
+    TPL0102Power(TPL0102 &pot);
+
+    // Methods:
+    void setSchedule(unsigned long periodMs, unsigned long activeMs);
+    uint8_t start(void);
+    uint8_t stop(void);
+    uint8_t service(void);
+    bool active(void);
+    uint8_t setTap(uint8_t chan, uint8_t tap);
+    uint8_t setTaps(uint8_t tapA, uint8_t tapB);
+    unsigned long activeMillis(void);
+    unsigned long shutdownMillis(void);
+    float dutyCycle(void);
+    unsigned long transitions(void);
+    void resetCounters(void);
+
+  private:
+
+    TPL0102 *_pot;
+    unsigned long _period;
+    unsigned long _activeWindow;
+    unsigned long _periodStart;
+    unsigned long _lastAccount;
+    unsigned long _activeTime;
+    unsigned long _shutdownTime;
+    unsigned long _transitions;
+    uint8_t _pendingMask;       // bit 0: POT A, bit 1: POT B
+    uint8_t _pendingTap[2];
+    bool _running;
+    bool _active;
+
+    void account(unsigned long now);
+    uint8_t wake(void);
+    uint8_t sleep(void);
+
+};
+
+#endif
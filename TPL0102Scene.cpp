@@ -0,0 +1,130 @@
+/*
+    TPL0102Scene: named operating points (presets) for every pot on a TPL0102Bus
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Scene.h"
+
+
+// Constructor
+
+TPL0102Scene::TPL0102Scene(TPL0102Bus &bus) {
+
+  _bus = &bus;
+  _presets = NULL;
+  _count = 0;
+  _current = TPL0102_NO_PRESET;
+  _inFlash = false;
+
+}
+
+// The store is not copied: it has to outlive the scene object
+void TPL0102Scene::setPresets(const TPL0102Preset *presets, uint8_t count, bool inFlash) {
+
+  _presets = presets;
+  _count = (presets != NULL) ? count : 0;
+  _inFlash = inFlash;
+
+}
+
+uint8_t TPL0102Scene::presetCount() {
+
+  return _count;
+
+}
+
+// Jump to a preset. Only the devices whose wipers change are addressed.
+// Returns the first I2C error (0: OK) or TPL0102_INVALID_PRESET
+uint8_t TPL0102Scene::applyPreset(uint8_t id) {
+
+  TPL0102Preset target;
+
+  if (!load(id, target))
+    return TPL0102_INVALID_PRESET;
+
+  uint8_t res = _bus->applyAll(target);
+
+  if (res == 0)
+    _current = id;
+
+  return res;
+
+}
+
+// Move from the current wipers to a preset in steps batched updates, stepDelay usec apart.
+// Every step is a single applyAll(): the devices that change share one bus session
+uint8_t TPL0102Scene::crossfade(uint8_t id, uint8_t steps, unsigned int stepDelay) {
+
+  TPL0102Preset target;
+  TPL0102Preset from;
+  TPL0102Preset frame;
+
+  if (!load(id, target))
+    return TPL0102_INVALID_PRESET;
+
+  if (steps < 2)
+    return applyPreset(id);
+
+  capture(from);
+
+  for (uint8_t step = 1; step <= steps; step++) {
+
+    for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+      for (uint8_t ch = 0; ch < 2; ch++) {
+
+        int delta = (int)target[dev][ch] - from[dev][ch];
+
+        frame[dev][ch] = from[dev][ch] + (delta * step) / steps;
+      }
+    }
+
+    uint8_t res = _bus->applyAll(frame);
+
+    if (res != 0)
+      return res;
+
+    if (stepDelay && (step < steps))
+      delayMicroseconds(stepDelay);
+  }
+
+  _current = id;
+
+  return 0;
+
+}
+
+// Last preset applied completely, TPL0102_NO_PRESET otherwise
+uint8_t TPL0102Scene::current() {
+
+  return _current;
+
+}
+
+// Snapshot of the bus table, e.g. to build a preset in RAM from the pots as they are now
+void TPL0102Scene::capture(TPL0102Preset &preset) {
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    preset[dev][CHA] = _bus->taps(dev, CHA);
+    preset[dev][CHB] = _bus->taps(dev, CHB);
+  }
+
+}
+
+bool TPL0102Scene::load(uint8_t id, TPL0102Preset &preset) {
+
+  if (id >= _count)
+    return false;
+
+  const uint8_t *src = &_presets[id][0][0];
+  uint8_t *dst = &preset[0][0];
+
+  for (uint8_t i = 0; i < sizeof(TPL0102Preset); i++)
+    dst[i] = _inFlash ? pgm_read_byte(&src[i]) : src[i];
+
+  return true;
+
+}
@@ -0,0 +1,47 @@
+/*
+    TPL0102Scene: named operating points (presets) for every pot on a TPL0102Bus
+    Author: Daniel Melendrez
+    A preset holds both wipers of every device. Applying one sends only the registers that
+    differ from the bus table, one dual-register transaction per changed device, chained
+    with repeated START. The preset store belongs to the caller (RAM or PROGMEM).
+    License: MIT
+
+*/
+
+#ifndef TPL0102Scene_h
+#define TPL0102Scene_h
+
+#include "TPL0102Bus.h"
+
+#define TPL0102_NO_PRESET 0xFF      // current() before any preset was applied
+
+typedef uint8_t TPL0102Preset[TPL0102_BUS_MAX_DEVICES][2];     // [device (A2A1A0)][channel]
+
+class TPL0102Scene {
+
+  public:
+
+    // Constructor:
+    TPL0102Scene(TPL0102Bus &bus);
+
+    // Methods:
+    void setPresets(const TPL0102Preset *presets, uint8_t count, bool inFlash);
+    uint8_t presetCount(void);
+    uint8_t applyPreset(uint8_t id);
+    uint8_t crossfade(uint8_t id, uint8_t steps, unsigned int stepDelay = 0);
+    uint8_t current(void);
+    void capture(TPL0102Preset &preset);
+
+  private:
+
+    TPL0102Bus *_bus;
+    const TPL0102Preset *_presets;
+    uint8_t _count;
+    uint8_t _current;
+    bool _inFlash;
+
+    bool load(uint8_t id, TPL0102Preset &preset);
+
+};
+
+#endif
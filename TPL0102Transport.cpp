@@ -0,0 +1,110 @@
+/*
+    TPL0102Transport: the I2C primitives the TPL0102 driver needs, behind one interface
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Transport.h"
+
+// Backends without a hardware queue complete the write before returning
+bool TPL0102Transport::writeAsync(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, TPL0102TransportCallback cb, void *context) {
+
+  uint8_t res = write(addr, reg, data, len, true);
+
+  if (cb != NULL)
+    cb(context, res);
+
+  return true;
+
+}
+
+// Constructor
+
+TPL0102WireTransport::TPL0102WireTransport(TwoWire &wirePort) {
+
+  _wire = &wirePort;
+
+}
+
+// One transport per TwoWire, created on first use and shared by every driver on that bus.
+// Past TPL0102_MAX_WIRE_BUSES each call gets its own: pass a TPL0102WireTransport to begin() instead
+TPL0102WireTransport *TPL0102WireTransport::forBus(TwoWire *wire) {
+
+  static TPL0102WireTransport *shared[TPL0102_MAX_WIRE_BUSES];
+
+  for (uint8_t i = 0; i < TPL0102_MAX_WIRE_BUSES; i++) {
+
+    if (shared[i] == NULL)
+      shared[i] = new TPL0102WireTransport(*wire);
+
+    if (shared[i]->_wire == wire)
+      return shared[i];
+  }
+
+  return new TPL0102WireTransport(*wire);
+
+}
+
+void TPL0102WireTransport::begin(uint32_t speed, int sda, int scl) {
+
+#if defined(ESP32)
+  if ((sda >= 0) && (scl >= 0))
+    _wire->begin(sda, scl);
+  else
+    _wire->begin();
+#else
+  (void)sda;
+  (void)scl;
+  _wire->begin();     // Fixed pins on the other cores
+#endif
+
+  _wire->setClock(speed);
+
+}
+
+void TPL0102WireTransport::end() {
+
+  _wire->end();
+
+}
+
+void TPL0102WireTransport::setClock(uint32_t speed) {
+
+  _wire->setClock(speed);
+
+}
+
+// Without real repeated START (TPL0102_WIRE_REPEATED_START 0) every write ends with a STOP
+uint8_t TPL0102WireTransport::write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, bool stop) {
+
+  _wire->beginTransmission(addr);
+  _wire->write(reg);
+  _wire->write(data, len);
+
+  return _wire->endTransmission(stop || !TPL0102_WIRE_REPEATED_START);
+
+}
+
+// Pointer write, repeated START, burst read. A short read counts as a bus error (4)
+uint8_t TPL0102WireTransport::read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, uint8_t &count) {
+
+  count = 0;
+
+  _wire->beginTransmission(addr);
+  _wire->write(reg);
+  uint8_t res = _wire->endTransmission(false);   // --> Thanks to https://forum.arduino.cc/index.php?topic=385377.0
+
+  if (res != 0)
+    return res;
+
+  _wire->requestFrom(static_cast<uint16_t>(addr), static_cast<size_t>(len), static_cast<bool>(true));
+
+  while (_wire->available() && (count < len))   // slave may send less than requested
+  {
+    buf[count++] = (uint8_t)_wire->read();    // receive a byte
+  }
+
+  return (count < len) ? 4 : 0;
+
+}
@@ -0,0 +1,85 @@
+/*
+    TPL0102Transport: the I2C primitives the TPL0102 driver needs, behind one interface
+    Author: Daniel Melendrez
+    A transaction is always "register pointer + data": write() sends it (stop = false ends it
+    with a repeated START into the next one, see chaining()), read() sets the pointer and reads a burst back.
+    TPL0102WireTransport puts the Arduino TwoWire API behind it and is the default. Other
+    backends (e.g. TPL0102IdfTransport on the ESP32) may queue the work to the hardware.
+    License: MIT
+
+*/
+
+#ifndef TPL0102Transport_h
+#define TPL0102Transport_h
+
+#include "Arduino.h"
+#include <Wire.h>
+
+#define TPL0102_MAX_WIRE_BUSES 2      // Shared Wire transports (Wire and Wire1)
+
+// What a write with stop = false does on a transport (chaining())
+#define TPL0102_CHAIN_NONE 0          // Nothing usable: every write has to end with a STOP
+#define TPL0102_CHAIN_SENT 1          // Sent at once with its own result, the bus stays claimed (repeated START)
+#define TPL0102_CHAIN_DEFERRED 2      // Only queued (0 is no ack): the result comes with the write that sends the STOP
+#define TPL0102_CHAIN_MAX_STEPS 16    // Deferred writes a ramp queues before it sends them
+
+// arduino-esp32 only stages an endTransmission(false) write for the requestFrom() that should follow:
+// a new beginTransmission() throws it away and it still returns 0. Chained writes need real repeated START
+#ifndef TPL0102_WIRE_REPEATED_START
+#if defined(ESP32)
+#define TPL0102_WIRE_REPEATED_START 0
+#else
+#define TPL0102_WIRE_REPEATED_START 1
+#endif
+#endif
+
+// Completion of writeAsync(): the Wire status of the transaction (0: OK).
+// The TPL0102 driver never calls writeAsync(): its own async path (setTapAsync() / poll()) does
+// blocking writes from poll() or its task. writeAsync() is for sketches talking to the transport directly
+typedef void (*TPL0102TransportCallback)(void *context, uint8_t result);
+
+class TPL0102Transport {
+
+  public:
+
+    // Pins < 0 keep the default pins of the bus
+    virtual void begin(uint32_t speed, int sda, int scl) = 0;
+    virtual void end(void) = 0;
+    virtual void setClock(uint32_t speed) = 0;
+    // Both return Wire's status codes: 0 OK, 2 address NACK, 3 data NACK, 4 other, 5 timeout
+    virtual uint8_t write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, bool stop) = 0;
+    virtual uint8_t read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, uint8_t &count) = 0;
+    virtual bool writeAsync(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, TPL0102TransportCallback cb, void *context);
+    virtual uint8_t chaining(void) { return TPL0102_CHAIN_NONE; }
+    // Identifies the physical bus: transports returning the same key share one bus mutex
+    virtual const void *busKey(void) { return this; }
+
+  protected:
+    ~TPL0102Transport() {}    // Not deleted through the interface
+
+};
+
+class TPL0102WireTransport : public TPL0102Transport {
+
+  public:
+
+    // Constructor:
+    explicit TPL0102WireTransport(TwoWire &wirePort = Wire);
+
+    // Methods:
+    static TPL0102WireTransport *forBus(TwoWire *wire);
+    void begin(uint32_t speed, int sda, int scl);
+    void end(void);
+    void setClock(uint32_t speed);
+    uint8_t write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len, bool stop);
+    uint8_t read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, uint8_t &count);
+    uint8_t chaining(void) { return TPL0102_WIRE_REPEATED_START ? TPL0102_CHAIN_SENT : TPL0102_CHAIN_NONE; }
+    const void *busKey(void) { return _wire; }    // Same key as TPL0102Bus / TPL0102Fixed on this TwoWire
+
+  private:
+
+    TwoWire *_wire;
+
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+    TPL0102Wave: plays a precomputed tap sequence at a fixed sample rate
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "TPL0102Wave.h"
+
+
+// Constructor
+
+TPL0102Wave::TPL0102Wave(TPL0102 &pot) {
+
+  _pot = &pot;
+  _playing = false;
+  _played = 0;
+  _missed = 0;
+
+}
+
+// Methods
+
+// length is in frames: for TPL0102_WAVE_STEREO the buffer holds 2 * length samples.
+// The achievable rate is bounded by the bus: ~3 kHz at STANDARD, ~10 kHz at FAST for one channel.
+// Rates above 1 MHz (a period under 1 us, the micros() resolution) are rejected
+bool TPL0102Wave::play(const uint8_t *samples, uint16_t length, uint32_t rateHz, uint8_t mode, bool inFlash, bool repeat) {
+
+  if ((samples == NULL) || (length == 0) || (rateHz == 0) || (rateHz > 1000000UL) || (mode > TPL0102_WAVE_STEREO))
+    return false;
+
+  _playing = false;
+
+  _samples = samples;
+  _length = length;
+  _mode = mode;
+  _inFlash = inFlash;
+  _repeat = repeat;
+  _position = 0;
+  _period = 1000000UL / rateHz;
+  _played = 0;
+  _missed = 0;
+  _startTime = micros();
+  _nextDue = _startTime;
+
+  _playing = true;
+
+#if defined(ESP32)
+  startTimer();     // Re-armed with the new period when the task runs
+#endif
+
+  return true;
+
+}
+
+void TPL0102Wave::stop() {
+
+  _playing = false;
+
+#if defined(ESP32)
+  if (_timer != NULL)
+    esp_timer_stop(_timer);
+#endif
+
+}
+
+bool TPL0102Wave::playing() {
+
+  return _playing;
+
+}
+
+// Write the frame that is due, if any. Deadlines are kept on a fixed grid from the start time,
+// so jitter in the calls never accumulates. Frames whose slot has already gone by are skipped
+// and counted as missed. Returns the I2C result of the write (0 when nothing was due)
+uint8_t TPL0102Wave::service() {
+
+  if (!_playing)
+    return 0;
+
+  unsigned long now = micros();
+
+  if ((long)(now - _nextDue) < 0)
+    return 0;
+
+  unsigned long late = (now - _nextDue) / _period;
+
+  if (late) {
+
+    _missed += late;
+    _nextDue += late * _period;
+    _position = (_position + late) % _length;
+
+    if (!_repeat && (_played + _missed >= _length)) {
+      _playing = false;
+      return 0;
+    }
+  }
+
+  uint8_t res = writeFrame();
+
+  _nextDue += _period;
+  _played++;
+
+  if (++_position >= _length) {
+
+    _position = 0;
+
+    if (!_repeat)
+      _playing = false;
+  }
+
+  return res;
+
+}
+
+// Frames per second actually written since play()
+float TPL0102Wave::achievedRate() {
+
+  unsigned long elapsed = micros() - _startTime;
+
+  return elapsed ? (_played * 1000000.0) / elapsed : 0;
+
+}
+
+unsigned long TPL0102Wave::samplesPlayed() {
+
+  return _played;
+
+}
+
+unsigned long TPL0102Wave::missedDeadlines() {
+
+  return _missed;
+
+}
+
+#if defined(ESP32)
+// Dedicated task, blocked between frames: a periodic esp_timer at the sample rate notifies it, so it
+// never spins whatever the rate (a 1 kHz wave is below one FreeRTOS tick per frame). Core 0 by
+// default, away from loop()
+bool TPL0102Wave::startTask(uint8_t core, uint8_t priority) {
+
+  if (_task != NULL)
+    return true;
+
+  if (_timer == NULL) {
+
+    esp_timer_create_args_t args = {};
+
+    args.callback = timerTick;
+    args.arg = this;
+    args.name = "TPL0102Wave";
+
+    if (esp_timer_create(&args, &_timer) != ESP_OK)
+      return false;
+  }
+
+  if (xTaskCreatePinnedToCore(taskLoop, "TPL0102Wave", 2048, this, priority, &_task, core) != pdPASS)
+    return false;
+
+  if (_playing)
+    startTimer();
+
+  return true;
+
+}
+
+void TPL0102Wave::startTimer() {
+
+  if ((_timer == NULL) || (_task == NULL))
+    return;
+
+  esp_timer_stop(_timer);     // Fails harmlessly when it was not running
+  esp_timer_start_periodic(_timer, _period);
+
+}
+
+// esp_timer task context: only wakes the wave task
+void TPL0102Wave::timerTick(void *arg) {
+
+  TPL0102Wave *wave = static_cast<TPL0102Wave *>(arg);
+
+  xTaskNotifyGive(wave->_task);
+
+}
+
+void TPL0102Wave::taskLoop(void *arg) {
+
+  TPL0102Wave *wave = static_cast<TPL0102Wave *>(arg);
+
+  while (true) {
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);      // Blocked until the next frame period
+
+    // The timer may fire a little ahead of the grid: wait out the rest (under one period)
+    long early = (long)(wave->_nextDue - micros());
+
+    if (wave->_playing && (early > 0) && (early < (long)wave->_period))
+      delayMicroseconds(early);
+
+    wave->service();
+
+    if (!wave->_playing)
+      esp_timer_stop(wave->_timer);     // One-shot playback finished
+  }
+}
+#endif
+
+uint8_t TPL0102Wave::sample(uint16_t index) {
+
+  return _inFlash ? pgm_read_byte(&_samples[index]) : _samples[index];
+
+}
+
+uint8_t TPL0102Wave::writeFrame() {
+
+  switch (_mode) {
+
+    case TPL0102_WAVE_A:
+      _pot->setTap(CHA, sample(_position));
+      return _pot->lastError();
+
+    case TPL0102_WAVE_B:
+      _pot->setTap(CHB, sample(_position));
+      return _pot->lastError();
+
+    case TPL0102_WAVE_BOTH:
+      return _pot->setTaps(sample(_position), sample(_position));
+
+    default:    // TPL0102_WAVE_STEREO
+      return _pot->setTaps(sample(2 * _position), sample(2 * _position + 1));
+  }
+}
@@ -0,0 +1,71 @@
+/*
+    TPL0102Wave: plays a precomputed tap sequence (sine, triangle...) at a fixed sample rate
+    Author: Daniel Melendrez
+    The buffer is owned by the caller (RAM or PROGMEM). service() writes the samples that are due,
+    call it from loop(), from a timer-driven task or let the ESP32 task do it.
+    License: MIT
+
+*/
+
+#ifndef TPL0102Wave_h
+#define TPL0102Wave_h
+
+#include "TPL0102.h"
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif
+
+// Channel modes
+#define TPL0102_WAVE_A 0          // Samples go to POT A
+#define TPL0102_WAVE_B 1          // Samples go to POT B
+#define TPL0102_WAVE_BOTH 2       // Same sample on both pots (dual-register write)
+#define TPL0102_WAVE_STEREO 3     // Interleaved A,B pairs (dual-register write)
+
+class TPL0102Wave {
+
+  public:
+
+    // Constructor:
+    TPL0102Wave(TPL0102 &pot);
+
+    // Methods:
+    bool play(const uint8_t *samples, uint16_t length, uint32_t rateHz, uint8_t mode, bool inFlash, bool repeat);
+    void stop(void);
+    bool playing(void);
+    uint8_t service(void);
+    float achievedRate(void);
+    unsigned long samplesPlayed(void);
+    unsigned long missedDeadlines(void);
+#if defined(ESP32)
+    bool startTask(uint8_t core = 0, uint8_t priority = 2);   // Off the loop() core
+#endif
+
+  private:
+
+    TPL0102 *_pot;
+    const uint8_t *_samples;
+    uint16_t _length;       // In frames (a STEREO frame is two samples)
+    uint16_t _position;
+    unsigned long _period;  // usec
+    unsigned long _nextDue;
+    unsigned long _startTime;
+    unsigned long _played;
+    unsigned long _missed;
+    uint8_t _mode;
+    bool _inFlash;
+    bool _repeat;
+    volatile bool _playing;
+#if defined(ESP32)
+    TaskHandle_t _task = NULL;
+    esp_timer_handle_t _timer = NULL;     // Wakes the task once per frame
+    static void taskLoop(void *arg);
+    static void timerTick(void *arg);
+    void startTimer(void);
+#endif
+
+    uint8_t sample(uint16_t index);
+    uint8_t writeFrame(void);
+
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for driving several pots sharing the same I2C bus
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102Bus.h>
+
+/* **** VARIABLES *******************/
+uint8_t targets[TPL0102_BUS_MAX_DEVICES][2];   // [device (A2A1A0)][channel]
+uint8_t step = 0;
+
+TPL0102Bus pots = TPL0102Bus();     // One object for all the pots in the bus
+
+void setup() {
+
+  Serial.begin(115200);
+
+  delay(200);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("          Multi-device bus manager       "));
+  Serial.println(F("*****************************************"));
+
+  Serial.print(F("Pots found: "));
+  Serial.println(pots.begin(FAST));
+
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+
+    if (pots.present(dev)) {
+
+      Serial.print(F("0x"));
+      Serial.print(pots.deviceAddress(dev), HEX);
+      Serial.print(F(" --> A: "));
+      Serial.print(pots.taps(dev, CHA));
+      Serial.print(F(" B: "));
+      Serial.println(pots.taps(dev, CHB));
+    }
+  }
+}
+
+void loop() {
+
+  // Spread the pots across the range and move them all together
+  for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+    targets[dev][CHA] = step + (dev * 32);
+    targets[dev][CHB] = 255 - targets[dev][CHA];
+  }
+
+  pots.applyAll(targets);
+
+  step++;
+
+  delay(10);
+}
@@ -80,14 +80,14 @@ void loop() {
 
       chanPtr = pot.setChannel(1);
 
-      Serial.print(pot.POT_LABELS[chanPtr]);
+      Serial.print(pot.potLabel(chanPtr));
       Serial.println(pot.taps(chanPtr));
 
     } else if (serialIn.toInt() == 6) {
 
       chanPtr = pot.setChannel(0);
 
-      Serial.print(pot.POT_LABELS[chanPtr]);
+      Serial.print(pot.potLabel(chanPtr));
       Serial.println(pot.taps(chanPtr));
 
     } else if (serialIn.toInt() == 8) { // Resistance increase routine
@@ -132,7 +132,7 @@ void printRetrievedData() {
 
   // Print data on serial port
   Serial.println(F("*********************************"));
-  Serial.print(pot.POT_LABELS[chanPtr]);
+  Serial.print(pot.potLabel(chanPtr));
   Serial.print(" Tap --> ");
   Serial.println(tapNum);
 
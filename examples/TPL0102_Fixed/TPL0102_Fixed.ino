@@ -0,0 +1,59 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for the compile-time (template) driver in a 1 kHz control loop
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102Fixed.h>
+
+/* **** VARIABLES *******************/
+#define LOOP_PERIOD_US 1000   // 1 kHz
+
+unsigned long nextTick;
+uint8_t tap = 0;
+int8_t direction = 1;
+
+TPL0102Fixed<0x50, CHA> gain;     // Address and channel fixed at compile time
+TPL0102Fixed<0x50, CHB> offset;
+
+void setup() {
+
+  Serial.begin(115200);
+
+  delay(200);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("          Compile-time driver            "));
+  Serial.println(F("*****************************************"));
+
+  Serial.print(F("Begin: "));
+  Serial.println(gain.begin(FAST));     // Sets the bus up once
+  offset.attach();                      // Same bus, same chip
+
+  offset.setOhms(50000);
+
+  Serial.print(F("Offset tap: "));
+  Serial.println(offset.taps());
+
+  nextTick = micros();
+}
+
+void loop() {
+
+  if ((long)(micros() - nextTick) < 0)
+    return;
+
+  nextTick += LOOP_PERIOD_US;
+
+  // Triangle on the gain wiper: one two-byte write per tick
+  if ((tap == 0 && direction < 0) || (tap == 255 && direction > 0))
+    direction = -direction;
+
+  tap += direction;
+  gain.setTap(tap);
+}
@@ -0,0 +1,52 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for POT A and POT B wired in series as one 511 steps control
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102Gang.h>
+
+/* **** VARIABLES *******************/
+uint16_t target = 0;
+
+TPL0102 pot = TPL0102();
+TPL0102Gang gang(pot, TPL0102_GANG_SERIES);
+
+void setup() {
+
+  Serial.begin(115200);
+
+  delay(200);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("        Gang mode: A + B in series       "));
+  Serial.println(F("*****************************************"));
+
+  pot.begin(0x50, FAST);
+
+  Serial.print(F("Steps: "));
+  Serial.println(gang.steps());
+}
+
+void loop() {
+
+  gang.setStep(target);     // Both wipers, one transaction
+
+  Serial.print(F("Step: "));
+  Serial.print(gang.step());
+  Serial.print(F(" --> A: "));
+  Serial.print(pot.taps(CHA));
+  Serial.print(F(" B: "));
+  Serial.print(pot.taps(CHB));
+  Serial.print(F(" Ohms: "));
+  Serial.println(gang.readOhms());
+
+  target = (target + 1) % gang.steps();
+
+  delay(50);
+}
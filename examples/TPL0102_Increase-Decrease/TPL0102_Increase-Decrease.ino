@@ -109,7 +109,7 @@ void loop() {
 
       pot.setChannel(chanPtr);
       
-      Serial.print(pot.POT_LABELS[chanPtr]);
+      Serial.print(pot.potLabel(chanPtr));
       Serial.println(pot.taps(chanPtr));
       toggleLeds();
 
@@ -173,7 +173,7 @@ void printRetrievedData() {
 
   // Print data on serial port
   Serial.println(F("*********************************"));
-  Serial.print(pot.POT_LABELS[chanPtr]);
+  Serial.print(pot.potLabel(chanPtr));
   Serial.print(" Tap --> ");
   Serial.println(tapNum);
 
@@ -0,0 +1,63 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for duty-cycling the shutdown mode around measurement windows
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102Power.h>
+
+/* **** VARIABLES *******************/
+#define PERIOD_MS 1000    // One measurement per second
+#define ACTIVE_MS 50      // Pots powered for 50 ms of it
+
+unsigned long lastReport = 0;
+uint8_t gain = 0;
+
+TPL0102 pot = TPL0102();
+TPL0102Power power(pot);
+
+void setup() {
+
+  Serial.begin(115200);
+
+  delay(200);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("           Shutdown scheduler            "));
+  Serial.println(F("*****************************************"));
+
+  pot.begin(0x50, FAST);
+
+  power.setSchedule(PERIOD_MS, ACTIVE_MS);
+  power.start();
+}
+
+void loop() {
+
+  power.service();
+
+  if (power.active()) {
+    // Measurement window: read the sensor behind the pot here
+  } else {
+    // Asleep: the new gain is sent together with the next wake-up
+    power.setTap(CHA, gain);
+  }
+
+  if (millis() - lastReport >= 10000) {
+
+    lastReport = millis();
+    gain += 16;
+
+    Serial.print(F("Active ms: "));
+    Serial.print(power.activeMillis());
+    Serial.print(F(" Shutdown ms: "));
+    Serial.print(power.shutdownMillis());
+    Serial.print(F(" Duty: "));
+    Serial.println(power.dutyCycle() * 100.0);
+  }
+}
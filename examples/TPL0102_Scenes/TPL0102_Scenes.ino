@@ -0,0 +1,57 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for switching several pots between stored operating points (presets)
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102Scene.h>
+
+/* **** VARIABLES *******************/
+// [preset][device (A2A1A0)][channel]. Devices that are not on the bus are ignored
+const TPL0102Preset presets[3] PROGMEM = {
+  {{0, 0}, {0, 0}},           // Off
+  {{128, 64}, {200, 32}},     // Low power
+  {{255, 128}, {255, 96}},    // Full power
+};
+
+uint8_t next = 0;
+
+TPL0102Bus pots = TPL0102Bus();
+TPL0102Scene scenes(pots);
+
+void setup() {
+
+  Serial.begin(115200);
+
+  delay(200);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("            Presets and scenes           "));
+  Serial.println(F("*****************************************"));
+
+  Serial.print(F("Pots found: "));
+  Serial.println(pots.begin(FAST));
+
+  scenes.setPresets(presets, 3, true);    // Stored in flash
+}
+
+void loop() {
+
+  Serial.print(F("Preset "));
+  Serial.print(next);
+
+  // Even presets jump, odd ones fade in over 32 steps (2 ms apart)
+  uint8_t res = (next & 0x01) ? scenes.crossfade(next, 32, 2000) : scenes.applyPreset(next);
+
+  Serial.print(F(" --> I2C result: "));
+  Serial.println(res);
+
+  next = (next + 1) % scenes.presetCount();
+
+  delay(1000);
+}
@@ -0,0 +1,38 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for driving the pots from a PC over the binary frame protocol (TPL0102Link.h)
+      Ver: 0.1 - initial release
+      Date: October 2026
+
+      The serial port carries binary frames only: nothing else is printed. From a PC (Python + pyserial):
+
+        def frame(cmd, seq, updates):     # updates: [(device, channel, tap), ...]
+            body = [cmd, seq, len(updates)]
+            for dev, ch, tap in updates:
+                body += [(dev << 1) | ch, tap]
+            return bytes([0xA5] + body + [sum(body) & 0xFF])
+
+        port.write(frame(0x01, 0, [(0, 0, 128), (0, 1, 64), (1, 0, 255)]))
+        ack = port.read(5)                # 5A 01 00 status sum
+
+      At 115200 baud a full frame (16 updates) takes ~3 ms: several thousand setpoints per second
+*/
+
+#include <TPL0102Link.h>
+
+TPL0102Bus pots = TPL0102Bus();
+TPL0102Link link(pots, Serial);
+
+void setup() {
+
+  Serial.begin(115200);
+
+  pots.begin(FAST);
+}
+
+void loop() {
+
+  link.service();     // Never blocks: other work can run here too
+}
@@ -92,7 +92,7 @@ void loop() {
 
 	  pot.setChannel(chanPtr);
 	  
-	  Serial.print(pot.POT_LABELS[chanPtr]);
+	  Serial.print(pot.potLabel(chanPtr));
       Serial.println(pot.taps(chanPtr));
 
       toggleLeds();
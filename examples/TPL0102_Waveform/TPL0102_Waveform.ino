@@ -0,0 +1,58 @@
+/*
+      TI TPL0102 Library
+
+      Author: Daniel Melendrez
+      Code: Example code for playing a sine wave on POT A as a programmable attenuator
+      Ver: 0.1 - initial release
+      Date: October 2026
+*/
+
+#include <TPL0102.h>
+#include <TPL0102Wave.h>
+
+#define TPL0102_ADDRESS 0x50 //0x5x where x is 0-7 according to A2A1A0
+#define SAMPLE_RATE 1000     // Hz
+
+// One period of a sine wave, 64 taps, kept in flash
+const uint8_t SINE[64] PROGMEM = {
+  128, 140, 152, 165, 176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254,
+  255, 254, 253, 250, 245, 240, 234, 226, 218, 208, 198, 188, 176, 165, 152, 140,
+  128, 115, 103,  90,  79,  67,  57,  47,  37,  29,  21,  15,  10,   5,   2,   1,
+    0,   1,   2,   5,  10,  15,  21,  29,  37,  47,  57,  67,  79,  90, 103, 115
+};
+
+TPL0102 pot = TPL0102();
+TPL0102Wave wave = TPL0102Wave(pot);
+
+unsigned long lastReport = 0;
+
+void setup() {
+
+  Serial.begin(115200);
+
+  pot.begin(TPL0102_ADDRESS, FAST);
+
+  Serial.println(F("*****************************************"));
+  Serial.println(F("  TPL0102 256 taps Digital Potentiometer "));
+  Serial.println(F("               LIBRARY ver 0.1           "));
+  Serial.println(F("            Waveform player              "));
+  Serial.println(F("*****************************************"));
+
+  wave.play(SINE, sizeof(SINE), SAMPLE_RATE, TPL0102_WAVE_A, true, true);
+
+}
+
+void loop() {
+
+  wave.service();     // Keep loop() free of delay() calls
+
+  if (millis() - lastReport > 2000) {
+
+    lastReport = millis();
+
+    Serial.print(F("Rate [Hz]: "));
+    Serial.print(wave.achievedRate(), 1);
+    Serial.print(F(" Missed: "));
+    Serial.println(wave.missedDeadlines());
+  }
+}
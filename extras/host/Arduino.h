@@ -0,0 +1,87 @@
+/*
+    Host stand-in for Arduino.h: just enough of the core API to build the TPL0102 driver on a PC.
+    Author: Daniel Melendrez
+    Time is simulated: micros()/millis() only move when the mock bus or a delay advances them,
+    so the numbers of the benchmark do not depend on the speed of the host.
+    License: MIT
+
+*/
+
+#ifndef TPL0102_HOST_ARDUINO_h
+#define TPL0102_HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define SDA 18    // Arbitrary: recoverBus() only needs a pin number
+#define SCL 19
+
+#define PROGMEM
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+
+// Simulated clock, in microseconds
+extern unsigned long hostMicros;
+
+inline unsigned long micros() { return hostMicros; }
+inline unsigned long millis() { return hostMicros / 1000; }
+inline void delayMicroseconds(unsigned int us) { hostMicros += us; }
+inline void delay(unsigned long ms) { hostMicros += ms * 1000; }
+inline void yield() { hostMicros++; }     // Busy-wait loops must still make progress
+
+// GPIO: writes are recorded, reads see an idle (high) line
+extern uint8_t hostPinState[64];
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) { hostPinState[pin & 63] = val; }
+inline int digitalRead(uint8_t) { return HIGH; }
+
+// Print on top of stdout, for the debug builds
+class Print {
+
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t print(const char *s) { return ::printf("%s", s); }
+    size_t print(const __FlashStringHelper *s) { return ::printf("%s", reinterpret_cast<const char *>(s)); }
+    size_t print(char c) { return ::printf("%c", c); }
+    size_t print(int v, int base = DEC) { return ::printf((base == HEX) ? "%X" : "%d", v); }
+    size_t print(unsigned int v, int base = DEC) { return ::printf((base == HEX) ? "%X" : "%u", v); }
+    size_t print(long v, int base = DEC) { return ::printf((base == HEX) ? "%lX" : "%ld", v); }
+    size_t print(unsigned long v, int base = DEC) { return ::printf((base == HEX) ? "%lX" : "%lu", v); }
+    size_t print(double v, int digits = 2) { return ::printf("%.*f", digits, v); }
+
+    size_t println() { return ::printf("\n"); }
+    template <typename T> size_t println(T v) { return print(v) + println(); }
+    template <typename T> size_t println(T v, int fmt) { return print(v, fmt) + println(); }
+};
+
+class HardwareSerial : public Print {
+
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) { return (size_t)putchar(c); }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,240 @@
+/*
+    Host mock: simulated clock, GPIO and TwoWire with TPL0102 register files
+    Author: Daniel Melendrez
+    License: MIT
+
+*/
+
+#include "Arduino.h"
+#include "Wire.h"
+
+unsigned long hostMicros = 0;
+uint8_t hostPinState[64];
+
+HardwareSerial Serial;
+TwoWire Wire;
+TwoWire Wire1;
+
+TwoWire::TwoWire()
+  : _clock(100000), _present(0), _txAddr(0), _txLen(0), _rxLen(0), _rxPos(0), _failCount(0), _failResult(0), _staged(false) {
+
+  memset(_pointer, 0, sizeof(_pointer));
+  resetCounters();
+
+  for (uint8_t dev = 0; dev < 8; dev++) {
+
+    memset(_regs[dev], 0, MOCK_TPL0102_REGISTERS);
+    _regs[dev][0x00] = 0x80;    // Factory wiper position
+    _regs[dev][0x01] = 0x80;
+    _regs[dev][0x10] = 0x40;    // ACR: not shut down, non-volatile access
+  }
+}
+
+bool TwoWire::begin() {
+
+  return true;
+
+}
+
+bool TwoWire::begin(int, int) {
+
+  return true;
+
+}
+
+void TwoWire::setClock(uint32_t speed) {
+
+  _clock = speed;
+
+}
+
+void TwoWire::beginTransmission(uint16_t addr) {
+
+  if (_staged) {
+    _staged = false;
+    _counters.droppedWrites++;    // arduino-esp32: "Unfinished Repeated Start transaction"
+  }
+
+  _txAddr = (uint8_t)addr;
+  _txLen = 0;
+
+}
+
+size_t TwoWire::write(uint8_t val) {
+
+  if (_txLen >= BUFFER_LENGTH)
+    return 0;
+
+  _txBuf[_txLen++] = val;
+
+  return 1;
+
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+
+  size_t n = 0;
+
+  while ((n < len) && write(data[n]))
+    n++;
+
+  return n;
+
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+
+  if (TPL0102_HOST_ESP32 && !stop) {
+    _staged = true;     // Nothing on the bus yet, and no error either
+    return 0;
+  }
+
+  return transmit(stop);
+
+}
+
+// Address byte + data bytes. The register pointer auto-increments like the chip's does
+uint8_t TwoWire::transmit(bool stop) {
+
+  charge(1 + _txLen, stop);
+
+  if (_failCount) {
+    _failCount--;
+    _counters.nacks++;
+    return _failResult;
+  }
+
+  int dev = device(_txAddr);
+
+  if (dev < 0) {
+    _counters.nacks++;
+    return 2;     // Address NACK
+  }
+
+  if (_txLen == 0)
+    return 0;     // Probe
+
+  _pointer[dev] = _txBuf[0];
+
+  for (uint8_t i = 1; i < _txLen; i++) {
+
+    uint8_t r = _pointer[dev]++ % MOCK_TPL0102_REGISTERS;
+
+    if (r != 0x10)
+      _regs[dev][r] = _txBuf[i];
+    else
+      _regs[dev][r] = _txBuf[i] & ~0x20;    // WIP is read-only, the EEPROM write is instant here
+  }
+
+  return 0;
+
+}
+
+size_t TwoWire::requestFrom(uint16_t addr, size_t len, bool stop) {
+
+  if (_staged) {
+
+    _staged = false;
+
+    if (transmit(false) != 0)     // The staged pointer write, then the read after a repeated START
+      return 0;
+  }
+
+  _rxLen = 0;
+  _rxPos = 0;
+
+  if (len > BUFFER_LENGTH)
+    len = BUFFER_LENGTH;
+
+  int dev = device(addr);
+
+  if (dev < 0) {
+    charge(1, stop);
+    _counters.nacks++;
+    return 0;
+  }
+
+  for (size_t i = 0; i < len; i++)
+    _rxBuf[_rxLen++] = _regs[dev][_pointer[dev]++ % MOCK_TPL0102_REGISTERS];
+
+  charge(1 + len, stop);
+
+  return len;
+
+}
+
+int TwoWire::available() {
+
+  return _rxLen - _rxPos;
+
+}
+
+int TwoWire::read() {
+
+  return (_rxPos < _rxLen) ? _rxBuf[_rxPos++] : -1;
+
+}
+
+void TwoWire::attach(uint8_t addr) {
+
+  int dev = addr - 0x50;
+
+  if ((dev >= 0) && (dev < 8))
+    _present |= (1 << dev);
+
+}
+
+void TwoWire::detach(uint8_t addr) {
+
+  int dev = addr - 0x50;
+
+  if ((dev >= 0) && (dev < 8))
+    _present &= ~(1 << dev);
+
+}
+
+uint8_t TwoWire::reg(uint8_t addr, uint8_t r) {
+
+  int dev = device(addr);
+
+  return (dev < 0) ? 0 : _regs[dev][r % MOCK_TPL0102_REGISTERS];
+
+}
+
+void TwoWire::failNext(uint8_t count, uint8_t result) {
+
+  _failCount = count;
+  _failResult = result;
+
+}
+
+void TwoWire::resetCounters() {
+
+  memset(&_counters, 0, sizeof(_counters));
+
+}
+
+int TwoWire::device(uint16_t addr) {
+
+  int dev = (int)addr - 0x50;
+
+  if ((dev < 0) || (dev >= 8) || !(_present & (1 << dev)))
+    return -1;
+
+  return dev;
+
+}
+
+// START + 9 clocks per byte (8 data + ACK) + STOP or repeated START
+void TwoWire::charge(size_t bytes, bool stop) {
+
+  unsigned long clocks = 1 + 9 * bytes + (stop ? 1 : 0);
+  unsigned long us = (clocks * 1000000UL + _clock - 1) / _clock;
+
+  _counters.transactions++;
+  _counters.bytes += bytes;
+  _counters.busMicros += us;
+
+  hostMicros += us;
+
+}
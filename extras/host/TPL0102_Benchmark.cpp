@@ -0,0 +1,250 @@
+/*
+    TPL0102 host benchmark: bus cost and CPU cost of the driver paths, without hardware
+    Author: Daniel Melendrez
+    Build and run from the library folder:
+
+      g++ -std=gnu++11 -O2 -Iextras/host -I. extras/host/HostMock.cpp extras/host/TPL0102_Benchmark.cpp TPL0102.cpp TPL0102Transport.cpp TPL0102Bus.cpp -o tpl0102_bench
+      ./tpl0102_bench
+
+    Build it a second time with -DTPL0102_HOST_ESP32=1 for the arduino-esp32 Wire behaviour (no chained writes).
+
+    For every operation it reports the I2C transactions and bytes per call (from the mock Wire),
+    the simulated bus time per call at STANDARD and FAST and the host CPU cost per call
+    (TSC cycles on x86, nanoseconds elsewhere). Transactions and bytes are deterministic:
+    they are checked against the budgets below and the exit code is 1 when one is exceeded,
+    or when the cached wipers / ACR no longer match the mock chip (a write the driver took for
+    acked never reached it).
+    License: MIT
+
+*/
+
+#include "TPL0102Bus.h"
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_CPU_UNIT "cycles"
+static inline unsigned long long hostNow() { return __rdtsc(); }
+#else
+#define HOST_CPU_UNIT "ns"
+static inline unsigned long long hostNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#define BENCH_ADDRESS 0x50
+#define BENCH_CALLS 200
+
+enum benchOp{
+  BENCH_BEGIN,
+  BENCH_BEGIN_FAST,       // Restored from a snapshot, no lazy verification
+  BENCH_INC,
+  BENCH_DEC,
+  BENCH_SET_TAP,
+  BENCH_SET_TAP_SAME,     // Suppressed by the shadow cache
+  BENCH_SET_TAPS,
+  BENCH_SET_VALUE,
+  BENCH_SWITCH_POT,
+  BENCH_RAMP,             // 16 steps
+  BENCH_SLEEP_WAKE,       // switchPot(LOW) + wakeWithTaps() with both wipers changing
+  BENCH_OP_COUNT
+};
+
+struct benchBudget{
+  const char *name;
+  float maxTransactions;    // per call
+  float maxBytes;
+};
+
+// begin(): IVRA+IVRB burst and ACR read, each one pointer write + read
+static const benchBudget budgets[BENCH_OP_COUNT] = {
+  {"begin",          4, 9},
+  {"beginFast",      0, 0},
+  {"inc",            1, 3},
+  {"dec",            1, 3},
+  {"setTap",         1, 3},
+  {"setTap (same)",  0, 0},
+  {"setTaps",        1, 4},
+  {"setValue",       1, 3},
+  {"switchPot",      1, 3},
+  {"ramp",          16, 48},
+  {"sleep+wake",     3, 10},
+};
+
+static TPL0102 pot;
+static TPL0102Snapshot saved;
+
+static void runOp(uint8_t op, uint32_t speed, uint16_t i) {
+
+  switch (op) {
+
+    case BENCH_BEGIN:
+      pot.begin(BENCH_ADDRESS, speed);
+    break;
+
+    case BENCH_BEGIN_FAST:
+      pot.beginFast(BENCH_ADDRESS, saved, speed, false);
+    break;
+
+    case BENCH_INC:
+      pot.inc(CHA);
+    break;
+
+    case BENCH_DEC:
+      pot.dec(CHA);
+    break;
+
+    case BENCH_SET_TAP:
+      pot.setTap(CHA, (i & 1) ? 0x20 : 0x10);
+    break;
+
+    case BENCH_SET_TAP_SAME:
+      pot.setTap(CHA, 0x10);
+    break;
+
+    case BENCH_SET_TAPS:
+      pot.setTaps((i & 1) ? 0x20 : 0x10, (i & 1) ? 0x30 : 0x40);
+    break;
+
+    case BENCH_SET_VALUE:
+      pot.setValue(CHA, (i & 1) ? 50000.0 : 10000.0);
+    break;
+
+    case BENCH_SWITCH_POT:
+      pot.switchPot(CHA, (i & 1) ? LOW : HIGH);
+    break;
+
+    case BENCH_RAMP:
+      pot.ramp(CHA, (i & 1) ? 0x2F : 0x20, (i & 1) ? 0x20 : 0x2F);
+    break;
+
+    case BENCH_SLEEP_WAKE:
+      pot.switchPot(CHA, LOW);
+      pot.wakeWithTaps(i & 0xFF, ~i & 0xFF);
+    break;
+  }
+}
+
+// The cache says what the chip holds, and no write was lost on the way
+static bool consistent(TPL0102 &p) {
+
+  return (p.taps(CHA) == Wire.reg(BENCH_ADDRESS, WRA)) && (p.taps(CHB) == Wire.reg(BENCH_ADDRESS, WRB))
+         && (p.acr() == Wire.reg(BENCH_ADDRESS, ACR)) && (Wire.counters().droppedWrites == 0);
+
+}
+
+// Batches of several devices (repeated START between them where the core allows it)
+static bool busConsistent() {
+
+  TPL0102Bus bus;
+  uint8_t targets[TPL0102_BUS_MAX_DEVICES][2];
+
+  Wire.attach(BENCH_ADDRESS + 1);
+  Wire.attach(BENCH_ADDRESS + 2);
+  bus.begin(FAST);
+  Wire.resetCounters();
+
+  for (uint16_t i = 0; i < BENCH_CALLS; i++) {
+
+    for (uint8_t dev = 0; dev < TPL0102_BUS_MAX_DEVICES; dev++) {
+      targets[dev][CHA] = i + dev;
+      targets[dev][CHB] = i * 3 + dev;
+    }
+
+    bus.applyAll(targets);
+  }
+
+  for (uint8_t dev = 0; dev < 3; dev++) {
+
+    if ((bus.taps(dev, CHA) != Wire.reg(bus.deviceAddress(dev), WRA)) || (bus.taps(dev, CHB) != Wire.reg(bus.deviceAddress(dev), WRB)))
+      return false;
+  }
+
+  return Wire.counters().droppedWrites == 0;
+
+}
+
+// Put the pot where the operation expects it, outside the measurement
+static void prepare(uint8_t op, uint32_t speed) {
+
+  pot.begin(BENCH_ADDRESS, speed);
+  saved = pot.snapshot();
+
+  switch (op) {
+
+    case BENCH_INC:
+      pot.setTap(CHA, 0);
+    break;
+
+    case BENCH_DEC:
+      pot.setTap(CHA, BENCH_CALLS);
+    break;
+
+    case BENCH_SET_TAP_SAME:
+      pot.setTap(CHA, 0x10);
+    break;
+
+    case BENCH_RAMP:
+      pot.setTap(CHA, 0x20);
+    break;
+  }
+}
+
+int main() {
+
+  static const uint32_t speeds[2] = {STANDARD, FAST};
+  bool regression = false;
+
+  Wire.attach(BENCH_ADDRESS);
+
+  printf("TPL0102 host benchmark, %d calls per operation\n\n", BENCH_CALLS);
+  printf("%-14s %8s %8s %12s %12s %12s  %-8s %s\n", "operation", "tx/call", "B/call", "bus us STD", "bus us FAST", HOST_CPU_UNIT "/call", "budget", "cache");
+
+  for (uint8_t op = 0; op < BENCH_OP_COUNT; op++) {
+
+    float tx = 0;
+    float bytes = 0;
+    float busUs[2];
+    unsigned long long cpu = 0;
+    bool stale = false;
+
+    for (uint8_t s = 0; s < 2; s++) {
+
+      prepare(op, speeds[s]);
+      Wire.resetCounters();
+
+      unsigned long long start = hostNow();
+
+      for (uint16_t i = 0; i < BENCH_CALLS; i++)
+        runOp(op, speeds[s], i);
+
+      unsigned long long elapsed = hostNow() - start;
+      const MockBusCounters &c = Wire.counters();
+
+      tx = (float)c.transactions / BENCH_CALLS;
+      bytes = (float)c.bytes / BENCH_CALLS;
+      busUs[s] = (float)c.busMicros / BENCH_CALLS;
+
+      if (s == 1)
+        cpu = elapsed / BENCH_CALLS;    // FAST run: the CPU work is the same at both speeds
+
+      stale |= !consistent(pot);
+    }
+
+    bool over = (tx > budgets[op].maxTransactions) || (bytes > budgets[op].maxBytes);
+    regression |= over || stale;
+
+    printf("%-14s %8.2f %8.2f %12.1f %12.1f %12llu  %-8s %s\n", budgets[op].name, tx, bytes, busUs[0], busUs[1], cpu, over ? "EXCEEDED" : "ok", stale ? "STALE" : "ok");
+  }
+
+  bool busStale = !busConsistent();
+  regression |= busStale;
+
+  printf("%-14s %64s  %-8s %s\n", "bus applyAll", "", "", busStale ? "STALE" : "ok");
+
+  printf("\n%s (%s Wire)\n", regression ? "Budget exceeded or cache out of sync with the chip" : "All paths within budget",
+         TPL0102_HOST_ESP32 ? "arduino-esp32" : "repeated START");
+
+  return regression ? 1 : 0;
+
+}
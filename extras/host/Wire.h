@@ -0,0 +1,87 @@
+/*
+    Host mock of the TwoWire API with up to eight TPL0102 register files behind it.
+    Author: Daniel Melendrez
+    Every transaction is counted (transactions, bytes on the wire including the address byte)
+    and charged to the simulated clock: 9 clocks per byte plus START and STOP/repeated START,
+    at whatever speed setClock() selected (STANDARD, FAST...).
+    -DTPL0102_HOST_ESP32=1 emulates arduino-esp32: endTransmission(false) sends nothing, it stages
+    the write for the next requestFrom(), and a beginTransmission() in between drops it (counted)
+    License: MIT
+
+*/
+
+#ifndef TPL0102_HOST_WIRE_h
+#define TPL0102_HOST_WIRE_h
+
+#include "Arduino.h"
+
+#ifndef TPL0102_HOST_ESP32
+#define TPL0102_HOST_ESP32 0
+#endif
+#if TPL0102_HOST_ESP32
+#define TPL0102_WIRE_REPEATED_START 0     // What the driver has to assume on that core
+#endif
+
+#define BUFFER_LENGTH 32
+#define MOCK_TPL0102_REGISTERS 0x20     // WRA/IVRA, WRB/IVRB, general purpose ... ACR (0x10)
+
+struct MockBusCounters{
+  unsigned long transactions;
+  unsigned long bytes;      // Address byte included
+  unsigned long busMicros;  // Time the bus was busy
+  unsigned long nacks;
+  unsigned long droppedWrites;    // TPL0102_HOST_ESP32: staged writes thrown away by beginTransmission()
+};
+
+class TwoWire {
+
+  public:
+    TwoWire();
+
+    bool begin(void);
+    bool begin(int sda, int scl);
+    void end(void) {}
+    void setClock(uint32_t speed);
+
+    void beginTransmission(uint16_t addr);
+    size_t write(uint8_t val);
+    size_t write(const uint8_t *data, size_t len);
+    uint8_t endTransmission(bool stop = true);
+
+    size_t requestFrom(uint16_t addr, size_t len, bool stop = true);
+    int available(void);
+    int read(void);
+
+    // Mock side
+    void attach(uint8_t addr);      // A TPL0102 answers at addr (0x50-0x57)
+    void detach(uint8_t addr);
+    uint8_t reg(uint8_t addr, uint8_t r);
+    void failNext(uint8_t count, uint8_t result = 3);   // Next transactions fail with result
+    const MockBusCounters &counters(void) { return _counters; }
+    void resetCounters(void);
+
+  private:
+    uint32_t _clock;
+    uint8_t _present;     // bit per A2A1A0 value
+    uint8_t _regs[8][MOCK_TPL0102_REGISTERS];
+    uint8_t _pointer[8];
+    uint8_t _txAddr;
+    uint8_t _txBuf[BUFFER_LENGTH];
+    uint8_t _txLen;
+    uint8_t _rxBuf[BUFFER_LENGTH];
+    uint8_t _rxLen;
+    uint8_t _rxPos;
+    uint8_t _failCount;
+    uint8_t _failResult;
+    bool _staged;     // TPL0102_HOST_ESP32: endTransmission(false) waiting for requestFrom()
+    MockBusCounters _counters;
+
+    int device(uint16_t addr);
+    uint8_t transmit(bool stop);
+    void charge(size_t bytes, bool stop);
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif